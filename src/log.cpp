@@ -1,13 +1,29 @@
 #include "log.h"
 
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <stdarg.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
+#include <unistd.h>
+#include <zlib.h>
 
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <chrono>
 #include <functional>
 #include <map>
 
 #include "config.h"
+#include "log_binary.h"
+#include "log_io.h"
+#include "log_static.h"
 
 namespace mylog {
 
@@ -51,28 +67,528 @@ LogLevel::Level LogLevel::FromString(const std::string& str) {
     return LogLevel::UNKNOWN;
 #undef XX
 }
-LogEventWrap::LogEventWrap(LogEvent::ptr e) : m_event(e) {}
+LogEventWrap::LogEventWrap(LogEvent::ptr e) : m_event(std::move(e)) {}
 LogEventWrap::~LogEventWrap() { m_event->getLogger()->log(m_event->getLevel(), m_event); }
 
-void LogEvent::format(const char* fmt, ...) {
-    // 可变参数列表
-    va_list al;
-    va_start(al, fmt);  // 初始化
-    format(fmt, al);
-    va_end(al);  // 清理遍历参数列表
+void LogArgs::clear() {
+    m_fmt    = nullptr;
+    m_size   = 0;
+    m_onHeap = false;
+    m_heap.clear();
+}
+
+void LogArgs::assign(const char* fmt, const char* data, size_t len) {
+    clear();
+    m_fmt = fmt;
+    append(data, len);
+}
+
+void LogArgs::append(const char* v, size_t len) {
+    if (!m_onHeap && m_size + len <= kInlineSize) {
+        memcpy(m_inline + m_size, v, len);
+    } else {
+        if (!m_onHeap) {
+            m_heap.assign(m_inline, m_size);
+            m_onHeap = true;
+        }
+        m_heap.append(v, len);
+    }
+    m_size += len;
+}
+
+void LogArgs::addPointer(const char* v) {
+    if (v) {
+        addString(v, strlen(v));
+    } else {
+        // 与glibc的printf行为保持一致
+        addString("(null)", 6);
+    }
+}
+
+void LogArgs::addString(const char* v, size_t len) {
+    char buf[1 + sizeof(uint32_t)];
+    uint32_t n = len;
+    buf[0]     = static_cast<char>(STRING);
+    memcpy(buf + 1, &n, sizeof(n));
+    append(buf, sizeof(buf));
+    append(v, len);
+}
+
+void LogFields::clear() {
+    m_size   = 0;
+    m_onHeap = false;
+    m_heap.clear();
+}
+
+void LogFields::append(const char* v, size_t len) {
+    if (!m_onHeap && m_size + len <= kInlineSize) {
+        memcpy(m_inline + m_size, v, len);
+    } else {
+        if (!m_onHeap) {
+            m_heap.assign(m_inline, m_size);
+            m_onHeap = true;
+        }
+        m_heap.append(v, len);
+    }
+    m_size += len;
+}
+
+void LogFields::addKey(std::string_view key, Type type) {
+    char len = static_cast<char>(std::min<size_t>(key.size(), 255));
+    append(&len, 1);
+    append(key.data(), static_cast<unsigned char>(len));
+    char t = static_cast<char>(type);
+    append(&t, 1);
+}
+
+void LogFields::addString(std::string_view key, std::string_view v) {
+    addKey(key, STRING);
+    uint32_t n = v.size();
+    append(reinterpret_cast<const char*>(&n), sizeof(n));
+    append(v.data(), v.size());
+}
+
+bool LogFields::Next(const char*& cur, const char* end, std::string_view& key, int& type, uint64_t& num,
+                     const char*& str, uint32_t& len) {
+    if (cur >= end) {
+        return false;
+    }
+    size_t key_len = static_cast<unsigned char>(*cur++);
+    key            = std::string_view(cur, key_len);
+    cur += key_len;
+    type = static_cast<unsigned char>(*cur++);
+    if (type == STRING) {
+        memcpy(&len, cur, sizeof(len));
+        str = cur + sizeof(len);
+        cur = str + len;
+    } else {
+        memcpy(&num, cur, sizeof(num));
+        cur += sizeof(num);
+    }
+    return true;
+}
+
+void LogFields::render(std::string& out) const {
+    const char* cur = data();
+    const char* end = cur + m_size;
+    std::string_view key;
+    int type;
+    uint64_t num;
+    const char* str;
+    uint32_t len;
+    while (Next(cur, end, key, type, num, str, len)) {
+        out.append(1, ' ');
+        out.append(key.data(), key.size());
+        out.append(1, '=');
+        if (type == STRING) {
+            out.append(str, len);
+        } else if (type == INT) {
+            LogFormatter::AppendInt(out, static_cast<int64_t>(num));
+        } else if (type == UINT) {
+            LogFormatter::AppendUInt(out, num);
+        } else if (type == BOOL) {
+            out.append(num ? "true" : "false");
+        } else {
+            double v;
+            memcpy(&v, &num, sizeof(v));
+            char buf[32];
+            out.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr - buf);
+        }
+    }
+}
+
+bool LogArgs::Next(const char*& cur, const char* end, int& type, uint64_t& num, const char*& str, uint32_t& len) {
+    if (cur >= end) {
+        return false;
+    }
+    type = static_cast<unsigned char>(*cur++);
+    if (type == STRING) {
+        memcpy(&len, cur, sizeof(len));
+        str = cur + sizeof(len);
+        cur = str + len;
+    } else {
+        memcpy(&num, cur, sizeof(num));
+        cur += sizeof(num);
+    }
+    return true;
+}
+
+// 使用snprintf格式化单个参数，结果追加到out
+template <class T>
+static void AppendPrintf(std::string& out, const char* spec, T v) {
+    char buf[128];
+    int len = snprintf(buf, sizeof(buf), spec, v);
+    if (len < 0) {
+        return;
+    }
+    if ((size_t)len < sizeof(buf)) {
+        out.append(buf, len);
+    } else {
+        size_t old = out.size();
+        out.resize(old + len + 1);
+        snprintf(&out[old], len + 1, spec, v);
+        out.resize(old + len);
+    }
+}
+
+void LogArgs::render(std::string& out) const {
+    if (!m_fmt) {
+        return;
+    }
+    const char* cur     = data();
+    const char* end     = cur + m_size;
+    int type            = 0;
+    uint64_t num        = 0;
+    const char* str     = nullptr;
+    uint32_t len        = 0;
+
+    const char* p = m_fmt;
+    while (*p) {
+        if (*p != '%') {
+            const char* begin = p;
+            while (*p && *p != '%') {
+                ++p;
+            }
+            out.append(begin, p - begin);
+            continue;
+        }
+        if (p[1] == '%') {
+            out.append(1, '%');
+            p += 2;
+            continue;
+        }
+        // 解析 %[flags][width][.precision][length]conversion
+        // 参数的真实类型已经记录下来，length修饰符直接丢弃，按记录的类型重新生成
+        const char* begin = p++;
+        std::string spec("%");
+        while (*p && strchr("-+ #0", *p)) {
+            spec.append(1, *p++);
+        }
+        for (int part = 0; part < 2; ++part) {
+            if (part == 1) {
+                if (*p != '.') {
+                    break;
+                }
+                spec.append(1, *p++);
+            }
+            if (*p == '*') {
+                // 宽度或精度由参数指定
+                ++p;
+                if (Next(cur, end, type, num, str, len) && type != STRING) {
+                    spec.append(std::to_string(type == DOUBLE ? 0 : (int64_t)num));
+                }
+                continue;
+            }
+            while (*p >= '0' && *p <= '9') {
+                spec.append(1, *p++);
+            }
+        }
+        while (*p && strchr("hlLqjzt", *p)) {
+            ++p;
+        }
+        char conv = *p;
+        if (!conv) {
+            out.append(begin, p - begin);
+            break;
+        }
+        ++p;
+        if (conv == 'n') {
+            continue;
+        }
+        if (!Next(cur, end, type, num, str, len)) {
+            // 参数不足时原样输出
+            out.append(begin, p - begin);
+            continue;
+        }
+        double d  = 0;
+        int64_t i = 0;
+        if (type == DOUBLE) {
+            memcpy(&d, &num, sizeof(d));
+            i = (int64_t)d;
+        } else if (type != STRING) {
+            i = (int64_t)num;
+            d = type == INT ? (double)i : (double)num;
+        }
+        switch (conv) {
+            case 'd':
+            case 'i':
+                if (type == STRING) {
+                    out.append(str, len);
+                } else {
+                    AppendPrintf(out, (spec + "ll" + conv).c_str(), (long long)i);
+                }
+                break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                if (type == STRING) {
+                    out.append(str, len);
+                } else {
+                    AppendPrintf(out, (spec + "ll" + conv).c_str(), (unsigned long long)i);
+                }
+                break;
+            case 'c':
+                if (type == STRING) {
+                    out.append(str, len);
+                } else {
+                    AppendPrintf(out, (spec + conv).c_str(), (int)i);
+                }
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+                if (type == STRING) {
+                    out.append(str, len);
+                } else {
+                    AppendPrintf(out, (spec + conv).c_str(), d);
+                }
+                break;
+            case 'p':
+                if (type == STRING) {
+                    out.append(str, len);
+                } else {
+                    AppendPrintf(out, (spec + conv).c_str(), (void*)(uintptr_t)num);
+                }
+                break;
+            case 's':
+                if (type == DOUBLE) {
+                    AppendPrintf(out, "%g", d);
+                } else if (type != STRING) {
+                    AppendPrintf(out, "%lld", (long long)i);
+                } else if (spec.size() == 1) {
+                    out.append(str, len);
+                } else {
+                    AppendPrintf(out, (spec + conv).c_str(), std::string(str, len).c_str());
+                }
+                break;
+            default:
+                out.append(begin, p - begin);
+                break;
+        }
+    }
+}
+
+void LogStreamBuf::clear() {
+    if (m_heap.capacity() > kMaxKeepSize) {
+        std::string().swap(m_heap);
+    }
+    setp(m_inline, m_inline + kInlineSize);
+}
+
+void LogStreamBuf::grow(size_t n) {
+    size_t used = size();
+    if (static_cast<size_t>(epptr() - pptr()) >= n) {
+        return;
+    }
+    size_t cap = std::max<size_t>(2 * (epptr() - pbase()), used + n);
+    if (pbase() == m_inline) {
+        m_heap.resize(cap);
+        memcpy(&m_heap[0], m_inline, used);
+    } else {
+        m_heap.resize(cap);
+    }
+    setp(&m_heap[0], &m_heap[0] + cap);
+    pbump(used);
+}
+
+LogStreamBuf::int_type LogStreamBuf::overflow(int_type c) {
+    if (traits_type::eq_int_type(c, traits_type::eof())) {
+        return traits_type::not_eof(c);
+    }
+    grow(1);
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+    return c;
+}
+
+std::streamsize LogStreamBuf::xsputn(const char* s, std::streamsize n) {
+    grow(n);
+    memcpy(pptr(), s, n);
+    pbump(n);
+    return n;
+}
+
+LogStreamBuf::pos_type LogStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                             std::ios_base::openmode which) {
+    if (off == 0 && dir == std::ios_base::cur && (which & std::ios_base::out)) {
+        return pos_type(size());
+    }
+    return pos_type(off_type(-1));
+}
+
+LogStream& LogStream::operator<<(const void* v) {
+    if (m_formatted) {
+        return stream(v);
+    }
+    // 与std::ostream相同，空指针输出0
+    if (!v) {
+        return write("0", 1);
+    }
+    char* p = m_buf.reserve(kNumberSize);
+    p[0]    = '0';
+    p[1]    = 'x';
+    m_buf.commit(std::to_chars(p + 2, p + kNumberSize, reinterpret_cast<uintptr_t>(v), 16).ptr - p);
+    return *this;
+}
+
+void LogStream::printLiteral(const char*& p, LogFormatString::Spec* spec) {
+    while (*p) {
+        const char* begin = p;
+        while (*p && *p != '{' && *p != '}') {
+            ++p;
+        }
+        write(begin, p - begin);
+        if (!*p) {
+            break;
+        }
+        if (p[0] == p[1]) {
+            // {{ 或 }}
+            write(p, 1);
+            p += 2;
+            continue;
+        }
+        if (spec) {
+            p = LogFormatString::ParseSpec(p, *spec);
+            return;
+        }
+        // 参数已经用完，剩余的占位符原样输出(编译期检查保证不会发生)
+        write(p++, 1);
+    }
+}
+
+void LogStream::printInt(bool negative, unsigned long long v, const LogFormatString::Spec& spec) {
+    char* p     = m_buf.reserve(kNumberSize);
+    char* begin = p;
+    if (negative) {
+        *p++ = '-';
+        v    = -v;
+    }
+    if (spec.type == 'x' || spec.type == 'X') {
+        char* end = std::to_chars(p, begin + kNumberSize, v, 16).ptr;
+        if (spec.type == 'X') {
+            for (; p < end; ++p) {
+                if (*p >= 'a') {
+                    *p -= 'a' - 'A';
+                }
+            }
+        }
+        p = end;
+    } else {
+        p = std::to_chars(p, begin + kNumberSize, v).ptr;
+    }
+    m_buf.commit(p - begin);
+}
+
+void LogStream::printDouble(double v, const LogFormatString::Spec& spec) {
+    char* p = m_buf.reserve(kNumberSize * 2);
+    std::to_chars_result result;
+    char* last = p + kNumberSize * 2;
+    if (spec.type == 'f' || spec.type == 'e' || spec.type == 'g') {
+        std::chars_format format = spec.type == 'f'   ? std::chars_format::fixed
+                                   : spec.type == 'e' ? std::chars_format::scientific
+                                                      : std::chars_format::general;
+        result = std::to_chars(p, last, v, format, spec.precision >= 0 ? spec.precision : 6);
+    } else if (spec.precision >= 0) {
+        result = std::to_chars(p, last, v, std::chars_format::general, spec.precision);
+    } else {
+        // 默认为可以还原原值的最短表示
+        result = std::to_chars(p, last, v);
+    }
+    if (result.ec != std::errc()) {
+        // 精度过大(超出缓冲区)时按最短表示输出
+        result = std::to_chars(p, last, v);
+    }
+    m_buf.commit(result.ptr - p);
+}
+
+void LogStream::printPointer(uintptr_t v, const LogFormatString::Spec& spec) {
+    char* p   = m_buf.reserve(kNumberSize);
+    p[0]      = '0';
+    p[1]      = 'x';
+    char* end = std::to_chars(p + 2, p + kNumberSize, v, 16).ptr;
+    if (spec.type == 'X') {
+        for (char* i = p + 2; i < end; ++i) {
+            if (*i >= 'a') {
+                *i -= 'a' - 'A';
+            }
+        }
+    }
+    m_buf.commit(end - p);
+}
+
+void LogStream::clear() {
+    m_buf.clear();
+    if (m_stream) {
+        // 调用方可能修改过流的状态(例如std::hex)
+        m_stream->clear();
+        m_stream->flags(std::ios_base::skipws | std::ios_base::dec);
+        m_stream->precision(6);
+        m_stream->width(0);
+        m_stream->fill(' ');
+    }
+    m_formatted = false;
+}
+
+LogStream& LogStream::updateFormatted() {
+    const std::ostream& os = *m_stream;
+    m_formatted = os.flags() != (std::ios_base::skipws | std::ios_base::dec) || os.precision() != 6 ||
+                  os.width() != 0 || os.fill() != ' ';
+    return *this;
+}
+
+char* LogStream::ToChars(char* first, char* last, long long v) { return std::to_chars(first, last, v).ptr; }
+
+char* LogStream::ToChars(char* first, char* last, unsigned long long v) { return std::to_chars(first, last, v).ptr; }
+
+char* LogStream::ToChars(char* first, char* last, double v) {
+    return std::to_chars(first, last, v, std::chars_format::general, 6).ptr;
+}
+
+char* LogStream::ToChars(char* first, char* last, long double v) {
+    return std::to_chars(first, last, v, std::chars_format::general, 6).ptr;
+}
+
+const std::string LogEvent::getContent() const {
+    std::string content = m_ss.str();
+    m_args.render(content);
+    m_fields.render(content);
+    return content;
+}
+
+void LogEvent::appendContent(std::string& out) const {
+    out.append(m_ss.data(), m_ss.size());
+    m_args.render(out);
+    m_fields.render(out);
+}
+
+void LogEvent::flushArgs() {
+    std::string content;
+    m_args.render(content);
+    m_ss << content;
+    m_args.clear();
 }
 
 void LogEvent::format(const char* fmt, va_list al) {
-    char* buf = nullptr;
-    // 动态分配足够的内存来存放格式化后的字符串
-    int len = vasprintf(&buf, fmt, al);
-    if (len != -1) {
-        // vasprintf格式化成功，添加到 m_ss
-        m_ss << std::string(buf, len);
-        free(buf);
+    // 直接格式化到m_ss的缓冲区，空间不足时扩大后再格式化一次
+    va_list copy;
+    va_copy(copy, al);
+    const size_t size = 256;
+    int len           = vsnprintf(m_ss.reserve(size), size, fmt, al);
+    if (len >= 0 && (size_t)len >= size) {
+        len = vsnprintf(m_ss.reserve(len + 1), len + 1, fmt, copy);
+    }
+    va_end(copy);
+    if (len > 0) {
+        m_ss.commit(len);
     }
 }
-std::stringstream& LogEventWrap::getSS() { return m_event->getSS(); }
+LogStream& LogEventWrap::getSS() { return m_event->getSS(); }
 
 // 线程ID
 class ThreadIdFormatItem : public LogFormatter::FormatItem {
@@ -83,13 +599,25 @@ class ThreadIdFormatItem : public LogFormatter::FormatItem {
     }
 };
 
+// 线程名称
+class ThreadNameFormatItem : public LogFormatter::FormatItem {
+   public:
+    ThreadNameFormatItem(const std::string& str = "") {}
+    virtual void format(std::ostream& os, Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) override {
+        os << event->getThreadName();
+    }
+};
+
 // 日志内容
 class MessageFormatItem : public LogFormatter::FormatItem {
    public:
     MessageFormatItem(const std::string& str = "") {}
     virtual void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level,
                         LogEvent::ptr event) override {
-        os << event->getContent();
+        // 与编译后的指令相同，包括延迟格式化的参数和结构化字段
+        std::string content;
+        event->appendContent(content);
+        os.write(content.data(), content.size());
     }
 };
 
@@ -113,11 +641,8 @@ class DateTimeFormatItem : public LogFormatter::FormatItem {
     }
     virtual void format(std::ostream& os, std::shared_ptr<Logger> logger, LogLevel::Level level,
                         LogEvent::ptr event) override {
-        struct tm tm;
-        time_t time = event->getTime();
-        localtime_r(&time, &tm);  // 线程安全方法，而不是localtime
-        char buf[64];
-        strftime(buf, sizeof(buf), m_format.c_str(), &tm);
+        std::string buf;
+        LogFormatter::AppendDateTime(buf, m_format.c_str(), event->getTime(), event->getNsec());
         os << buf;
     }
 
@@ -137,10 +662,13 @@ class LevelFormatItem : public LogFormatter::FormatItem {
 // 时间长度
 class ElapseFormatItem : public LogFormatter::FormatItem {
    public:
-    ElapseFormatItem(const std::string& str = "") {}
+    ElapseFormatItem(const std::string& str = "") : m_divisor(LogFormatter::ElapseDivisor(str.data(), str.size())) {}
     virtual void format(std::ostream& os, Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) override {
-        os << event->getElapse();
+        os << event->getElapseNs() / m_divisor;
     }
+
+   private:
+    uint32_t m_divisor;
 };
 
 // 日志名称
@@ -188,7 +716,8 @@ class NewLineFormatItem : public LogFormatter::FormatItem {
    public:
     NewLineFormatItem(const std::string& str = "") {}
     virtual void format(std::ostream& os, Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) override {
-        os << std::endl;
+        // 不使用std::endl，避免每条日志都刷新输出流
+        os << "\n";
     }
 };
 
@@ -210,170 +739,2294 @@ LogEvent::LogEvent(std::shared_ptr<Logger> logger, LogLevel::Level level, const
       m_level(level),
       m_file(file),
       m_line(line),
-      m_elapse(elapse),
+      m_elapse(elapse * 1000000ULL),
       m_threadId(thread_id),
       m_fiberId(fiber_id),
-      m_time(time) {}
+      m_time(time) {
+    m_ss.setFields(&m_fields);
+}
+
+LogEvent::LogEvent(std::shared_ptr<Logger> logger, LogLevel::Level level, const char* file, int32_t line,
+                   uint32_t thread_id, uint32_t fiber_id, const struct timespec& time)
+    : LogEvent(logger, level, file, line, 0, thread_id, fiber_id, time.tv_sec) {
+    m_nsec         = time.tv_nsec;
+    uint64_t now   = getTimeNs();
+    uint64_t start = GetStartTimeNs();
+    m_elapse       = now > start ? now - start : 0;
+}
+
+void LogEvent::reset(const std::shared_ptr<Logger>& logger, LogLevel::Level level, const char* file, int32_t line,
+                     uint32_t thread_id, uint32_t fiber_id, const struct timespec& time) {
+    m_logger       = logger;
+    m_level        = level;
+    m_file         = file;
+    m_line         = line;
+    m_threadId     = thread_id;
+    m_fiberId      = fiber_id;
+    m_time         = time.tv_sec;
+    m_nsec         = time.tv_nsec;
+    uint64_t now   = getTimeNs();
+    uint64_t start = GetStartTimeNs();
+    m_elapse       = now > start ? now - start : 0;
+}
+
+void LogEvent::recycle() {
+    m_logger.reset();
+    m_ss.clear();
+    m_args.clear();
+    m_fields.clear();
+    m_formatCache = false;
+    m_formattedId = 0;
+    m_formatted.clear();
+}
+
+/**
+ * 线程局部的日志事件对象池
+ * 回收的LogEvent保留内容缓冲区与std::ostream，不需要重新构造；
+ * shared_ptr的控制块使用固定大小的内存块，同样在线程内缓存。
+ * 事件可能在其他线程释放(例如异步Appender的后台线程)，此时回收到释放线程的对象池，超过上限时直接释放内存
+ */
+class LogEventPool {
+   public:
+    static const size_t kMaxEvents = 64;
+    static const size_t kMaxBlocks = 64;
+    // 控制块的内存块大小
+    static const size_t kBlockSize = 64;
+
+    // 线程退出(对象池已经析构)后返回nullptr
+    static LogEventPool* Get() {
+        if (t_destroyed) {
+            return nullptr;
+        }
+        static thread_local LogEventPool s_pool;
+        return &s_pool;
+    }
+
+    ~LogEventPool() {
+        t_destroyed = true;
+        for (auto i : m_events) {
+            delete i;
+        }
+        for (auto i : m_blocks) {
+            ::operator delete(i);
+        }
+    }
+
+    LogEvent* acquire() {
+        if (m_events.empty()) {
+            return nullptr;
+        }
+        LogEvent* event = m_events.back();
+        m_events.pop_back();
+        return event;
+    }
+
+    // 对象池已满时返回false
+    bool release(LogEvent* event) {
+        if (m_events.size() >= kMaxEvents) {
+            return false;
+        }
+        event->recycle();
+        m_events.push_back(event);
+        return true;
+    }
+
+    static void* AllocateBlock(size_t size) {
+        if (size > kBlockSize) {
+            return ::operator new(size);
+        }
+        LogEventPool* pool = Get();
+        if (pool && !pool->m_blocks.empty()) {
+            void* block = pool->m_blocks.back();
+            pool->m_blocks.pop_back();
+            return block;
+        }
+        return ::operator new(kBlockSize);
+    }
+
+    static void FreeBlock(void* block, size_t size) {
+        if (size <= kBlockSize) {
+            LogEventPool* pool = Get();
+            if (pool && pool->m_blocks.size() < kMaxBlocks) {
+                pool->m_blocks.push_back(block);
+                return;
+            }
+        }
+        ::operator delete(block);
+    }
+
+    // 释放日志事件时调用
+    struct Recycler {
+        void operator()(LogEvent* event) const {
+            LogEventPool* pool = Get();
+            if (!pool || !pool->release(event)) {
+                delete event;
+            }
+        }
+    };
+
+    // shared_ptr控制块的分配器
+    template <class T>
+    struct Allocator {
+        typedef T value_type;
+        Allocator() {}
+        template <class U>
+        Allocator(const Allocator<U>&) {}
+        T* allocate(size_t n) { return static_cast<T*>(AllocateBlock(n * sizeof(T))); }
+        void deallocate(T* p, size_t n) { FreeBlock(p, n * sizeof(T)); }
+        template <class U>
+        bool operator==(const Allocator<U>&) const {
+            return true;
+        }
+        template <class U>
+        bool operator!=(const Allocator<U>&) const {
+            return false;
+        }
+    };
+
+   private:
+    LogEventPool() {
+        m_events.reserve(kMaxEvents);
+        m_blocks.reserve(kMaxBlocks);
+    }
+
+   private:
+    static thread_local bool t_destroyed;
+    std::vector<LogEvent*> m_events;
+    std::vector<void*> m_blocks;
+};
+
+thread_local bool LogEventPool::t_destroyed = false;
+
+LogEvent::ptr LogEvent::Create(const std::shared_ptr<Logger>& logger, LogLevel::Level level, const char* file,
+                               int32_t line, uint32_t thread_id, uint32_t fiber_id, const struct timespec& time) {
+    LogEventPool* pool = LogEventPool::Get();
+    LogEvent* event    = pool ? pool->acquire() : nullptr;
+    if (event) {
+        event->reset(logger, level, file, line, thread_id, fiber_id, time);
+    } else {
+        event = new LogEvent(logger, level, file, line, thread_id, fiber_id, time);
+    }
+    event->m_threadName = GetThreadName();
+    return LogEvent::ptr(event, LogEventPool::Recycler(), LogEventPool::Allocator<LogEvent>());
+}
 
-Logger::Logger(const std::string& name) : m_name(name), m_level(LogLevel::DEBUG) {
+static constexpr char kDefaultPattern[] = "%d%T%t %T%F%T[%p]%T[%c]%T%f:%l %T%m%n";
+
+Logger::Logger(const std::string& name)
+    : m_level(LogLevel::DEBUG),
+      m_name(name),
+      // 默认格式在编译期解析
+      m_formatter(StaticFormatter<kDefaultPattern>::Create()) {
     // 定义常见日志格式
     // m_formatter.reset(new LogFormatter("%d  [%p]  < %f : %l >    %m  %n"));
     // m_formatter.reset(new LogFormatter("%d{%Y-%m-%d %H:%M:%S}%T %t %T %F %T[%p]%T[%c]%T %f:%l %T %m%n"));
-    m_formatter.reset(new LogFormatter("%d%T%t %T%F%T[%p]%T[%c]%T%f:%l %T%m%n"));
 }
 
 // 虚函数必须要提供定义
 // TODO
 LogAppender::~LogAppender() {}
 
-void LogAppender::setFormatter(LogFormatter::ptr val) {
-    m_formatter = val;
-    if (m_formatter) {
-        m_hasFormatter = true;
-    } else {
-        m_hasFormatter = false;
+void LogAppender::setFormatter(LogFormatter::ptr val) {
+    m_hasFormatter = !!val;
+    m_formatter.store(val);
+}
+
+static uint64_t GetSteadyMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * 定时刷新设置了interval的Appender(进程内共用一个线程)
+ * interval只在写入日志时检查的话，停止写入后最后几条日志会一直留在缓冲区中
+ * 每隔最小interval的一半检查一次，上次刷新后有写入且超过interval时调用flushWrite
+ */
+class LogFlushTimer {
+   public:
+    static LogFlushTimer* GetInstance() {
+        static LogFlushTimer* s_instance = new LogFlushTimer;
+        return s_instance;
+    }
+
+    void add(const std::weak_ptr<LogAppender>& appender) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_appenders.push_back(appender);
+        if (!m_thread.joinable()) {
+            m_thread = std::thread(&LogFlushTimer::run, this);
+        }
+        // 按照新的interval重新计算等待时间
+        m_cond.notify_one();
+    }
+
+   private:
+    void run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            uint64_t now  = GetSteadyMs();
+            uint32_t wait = 1000;
+            for (auto it = m_appenders.begin(); it != m_appenders.end();) {
+                LogAppender::ptr appender = it->lock();
+                if (!appender) {
+                    it = m_appenders.erase(it);
+                    continue;
+                }
+                ++it;
+                uint32_t interval = appender->m_flushEveryMs.load(std::memory_order_relaxed);
+                if (!interval) {
+                    continue;
+                }
+                wait = std::min(wait, std::max(interval / 2, 1u));
+                if (now - appender->m_lastFlushMs.load(std::memory_order_relaxed) >= interval &&
+                    appender->m_flushDirty.exchange(false, std::memory_order_relaxed)) {
+                    appender->m_lastFlushMs.store(now, std::memory_order_relaxed);
+                    appender->flushWrite();
+                }
+            }
+            m_cond.wait_for(lock, std::chrono::milliseconds(wait));
+        }
+    }
+
+   private:
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::vector<std::weak_ptr<LogAppender>> m_appenders;
+    std::thread m_thread;
+};
+
+void LogAppender::setFlushPolicy(const LogFlushPolicy& val) {
+    m_flushEvery.store(val.every, std::memory_order_relaxed);
+    m_flushEveryMs.store(val.interval, std::memory_order_relaxed);
+    m_flushLevel.store(val.level, std::memory_order_relaxed);
+    m_syncLevel.store(val.sync_level, std::memory_order_relaxed);
+    m_flushEnabled.store(val.every || val.interval || val.level != LogLevel::UNKNOWN ||
+                             val.sync_level != LogLevel::UNKNOWN,
+                         std::memory_order_relaxed);
+    if (val.interval && !m_flushTimer.load(std::memory_order_relaxed)) {
+        // 构造函数中还没有shared_ptr，不能交给刷新线程
+        std::weak_ptr<LogAppender> self = weak_from_this();
+        if (!self.expired() && !m_flushTimer.exchange(true)) {
+            LogFlushTimer::GetInstance()->add(self);
+        }
+    }
+}
+
+void LogAppender::logBatch(std::shared_ptr<Logger> logger, const LogEvent::ptr* events, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        log(logger, events[i]->getLevel(), events[i]);
+    }
+}
+
+LogFlushPolicy LogAppender::getFlushPolicy() const {
+    LogFlushPolicy policy;
+    policy.every      = m_flushEvery.load(std::memory_order_relaxed);
+    policy.interval   = m_flushEveryMs.load(std::memory_order_relaxed);
+    policy.level      = m_flushLevel.load(std::memory_order_relaxed);
+    policy.sync_level = m_syncLevel.load(std::memory_order_relaxed);
+    return policy;
+}
+
+LogAppender::FlushAction LogAppender::flushAction(LogLevel::Level level) {
+    if (MYLOG_LIKELY(!m_flushEnabled.load(std::memory_order_relaxed))) {
+        return FLUSH_NONE;
+    }
+    FlushAction action          = FLUSH_NONE;
+    LogLevel::Level sync_level  = m_syncLevel.load(std::memory_order_relaxed);
+    LogLevel::Level flush_level = m_flushLevel.load(std::memory_order_relaxed);
+    uint32_t every              = m_flushEvery.load(std::memory_order_relaxed);
+    uint32_t interval           = m_flushEveryMs.load(std::memory_order_relaxed);
+    uint64_t now                = 0;
+    if (sync_level != LogLevel::UNKNOWN && level >= sync_level) {
+        action = FLUSH_SYNC;
+    } else if (flush_level != LogLevel::UNKNOWN && level >= flush_level) {
+        action = FLUSH_WRITE;
+    } else if (every && m_flushCount.fetch_add(1, std::memory_order_relaxed) + 1 >= every) {
+        action = FLUSH_WRITE;
+    } else if (interval) {
+        now = GetSteadyMs();
+        if (now - m_lastFlushMs.load(std::memory_order_relaxed) >= interval) {
+            action = FLUSH_WRITE;
+        }
+    }
+    if (action != FLUSH_NONE) {
+        // 刷新后重新开始计数、计时
+        m_flushCount.store(0, std::memory_order_relaxed);
+        if (interval) {
+            m_lastFlushMs.store(now ? now : GetSteadyMs(), std::memory_order_relaxed);
+            m_flushDirty.store(false, std::memory_order_relaxed);
+        }
+    } else if (interval && !m_flushDirty.load(std::memory_order_relaxed)) {
+        // 留给刷新线程
+        m_flushDirty.store(true, std::memory_order_relaxed);
+    }
+    return action;
+}
+
+void LogAppender::flushPolicyToYaml(YAML::Node& node) const {
+    LogFlushPolicy policy = getFlushPolicy();
+    if (policy.every) {
+        node["flush"]["every"] = policy.every;
+    }
+    if (policy.interval) {
+        node["flush"]["interval"] = policy.interval;
+    }
+    if (policy.level != LogLevel::UNKNOWN) {
+        node["flush"]["level"] = LogLevel::ToString(policy.level);
+    }
+    if (policy.sync_level != LogLevel::UNKNOWN) {
+        node["flush"]["sync_level"] = LogLevel::ToString(policy.sync_level);
+    }
+}
+
+void LogAppender::SyncFile(const std::string& filename) {
+    // fdatasync作用于文件本身，只读打开的描述符也可以
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    fdatasync(fd);
+    ::close(fd);
+}
+
+void Logger::inheritFormatter(const LogAppender::ptr& appender, const LogFormatter::ptr& formatter) {
+    if (!appender->m_hasFormatter) {
+        appender->m_formatter.store(formatter);
+    }
+}
+
+void Logger::addAppender(LogAppender::ptr appender) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!appender->getFormatter()) {
+        // appender->setFormatter(m_formatter);
+        inheritFormatter(appender, m_formatter.load());
+    }
+    std::vector<LogAppender::ptr> appenders = m_appenders.load();
+    appenders.push_back(appender);
+    m_appenders.store(appenders);
+}
+void Logger::delAppender(LogAppender::ptr appender) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<LogAppender::ptr> appenders = m_appenders.load();
+    for (auto it = appenders.begin(); it != appenders.end(); it++) {
+        if (*it == appender) {
+            appenders.erase(it);
+            m_appenders.store(appenders);
+            break;
+        }
+    }
+}
+
+void Logger::clearAppenders() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_appenders.store(std::vector<LogAppender::ptr>());
+}
+
+void Logger::setAppenders(const std::vector<LogAppender::ptr>& appenders) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    LogFormatter::ptr formatter = m_formatter.load();
+    for (auto& i : appenders) {
+        if (!i->getFormatter()) {
+            inheritFormatter(i, formatter);
+        }
+    }
+    m_appenders.store(appenders);
+}
+
+bool Logger::filter(LogLevel::Level level, const LogEvent::ptr& event, LogEvent::ptr& summary) {
+    // 日志等级覆盖
+    if (MYLOG_UNLIKELY(!isEnabled(level))) {
+        return false;
+    }
+    uint64_t interval = m_limitInterval.load(std::memory_order_relaxed);
+    if (MYLOG_UNLIKELY(interval != 0)) {
+        if (!m_limiter.tokenBucketNs(interval, m_limitBurst.load(std::memory_order_relaxed))) {
+            return false;
+        }
+        // 先输出一条汇总，说明此前被抑制的数量
+        if (uint64_t suppressed = m_limiter.takeSuppressed()) {
+            summary = LogEvent::Create(shared_from_this(), level, event->getFile(), event->getLine(),
+                                       event->getThreadId(), event->getFiberId(), GetRealTime());
+            summary->getSS() << "suppressed " << suppressed << " messages by rate limit of logger " << m_name;
+        }
+    }
+    return true;
+}
+
+void Logger::log(LogLevel::Level level, LogEvent::ptr event) {
+    LogEvent::ptr summary;
+    if (filter(level, event, summary)) {
+        if (MYLOG_UNLIKELY(!!summary)) {
+            dispatch(level, summary);
+        }
+        dispatch(level, event);
+    }
+}
+
+void Logger::log(const LogEvent::ptr* events, size_t count) {
+    // 没有被过滤掉的日志时直接使用调用方的数组
+    size_t passed = 0;
+    if (m_limitInterval.load(std::memory_order_relaxed) == 0) {
+        while (passed < count && isEnabled(events[passed]->getLevel())) {
+            ++passed;
+        }
+    }
+    if (MYLOG_LIKELY(passed == count)) {
+        dispatch(events, count);
+        return;
+    }
+    // 通过的日志(和限流的汇总)放入线程内复用的数组，交给Appender时可能再次输出日志，所以先取出来
+    static thread_local std::vector<LogEvent::ptr> t_batch;
+    std::vector<LogEvent::ptr> batch;
+    batch.swap(t_batch);
+    batch.assign(events, events + passed);
+    for (size_t i = passed; i < count; ++i) {
+        LogEvent::ptr summary;
+        if (filter(events[i]->getLevel(), events[i], summary)) {
+            if (summary) {
+                batch.push_back(std::move(summary));
+            }
+            batch.push_back(events[i]);
+        }
+    }
+    if (!batch.empty()) {
+        dispatch(batch.data(), batch.size());
+    }
+    batch.clear();
+    batch.swap(t_batch);
+}
+
+void Logger::dispatch(LogLevel::Level level, const LogEvent::ptr& event) {
+    // 获得指向自己的指针
+    auto self = shared_from_this();
+    // 读取当前的Appender集合，不加锁
+    RcuValue<std::vector<LogAppender::ptr>>::ReadLock appenders(m_appenders);
+    if (!appenders->empty()) {
+        // 输出到多个Appender时缓存格式化结果，共用formatter的Appender只格式化一次
+        event->setFormatCache(appenders->size() > 1);
+        for (auto& i : *appenders) {
+            i->log(self, level, event);
+        }
+    } else if (m_root) {
+        m_root->log(level, event);
+    }
+}
+
+void Logger::dispatch(const LogEvent::ptr* events, size_t count) {
+    auto self = shared_from_this();
+    RcuValue<std::vector<LogAppender::ptr>>::ReadLock appenders(m_appenders);
+    if (!appenders->empty()) {
+        bool cache = appenders->size() > 1;
+        for (size_t i = 0; i < count; ++i) {
+            events[i]->setFormatCache(cache);
+        }
+        for (auto& i : *appenders) {
+            i->logBatch(self, events, count);
+        }
+    } else if (m_root) {
+        m_root->log(events, count);
+    }
+}
+
+void Logger::setRateLimit(double rate, uint64_t burst) {
+    // 先设置burst，开始限流时不会读到0
+    m_limitBurst.store(burst ? burst : 1, std::memory_order_relaxed);
+    m_limitInterval.store(rate > 0 ? std::max<uint64_t>(1, 1e9 / rate) : 0, std::memory_order_relaxed);
+}
+
+double Logger::getRateLimit() const {
+    uint64_t interval = m_limitInterval.load(std::memory_order_relaxed);
+    return interval ? 1e9 / interval : 0;
+}
+
+uint64_t LogLimiter::NowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+bool LogLimiter::pass(uint64_t now) {
+    m_last.store(now, std::memory_order_relaxed);
+    return true;
+}
+
+bool LogLimiter::suppress() {
+    m_suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool LogLimiter::suppressCounted() {
+    uint64_t suppressed = m_suppressed.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (suppressed % kSummaryCheck != 0) {
+        return false;
+    }
+    uint64_t now  = NowNs();
+    uint64_t last = m_last.load(std::memory_order_relaxed);
+    if (last == 0) {
+        // 从来没有放行过，从现在开始计算汇总间隔
+        m_last.compare_exchange_strong(last, now, std::memory_order_relaxed);
+        return false;
+    }
+    // 只有一个线程能取得这次汇总
+    return now - last >= kSummaryIntervalNs && m_last.compare_exchange_strong(last, now, std::memory_order_relaxed);
+}
+
+bool LogLimiter::everyN(uint64_t n) {
+    uint64_t count = m_count.fetch_add(1, std::memory_order_relaxed);
+    if (n <= 1 || count % n == 0) {
+        return pass(NowNs());
+    }
+    return suppressCounted();
+}
+
+bool LogLimiter::firstN(uint64_t n) {
+    // 超过n次后不再增加计数，避免溢出
+    if (m_count.load(std::memory_order_relaxed) < n && m_count.fetch_add(1, std::memory_order_relaxed) < n) {
+        return pass(NowNs());
+    }
+    return suppressCounted();
+}
+
+bool LogLimiter::everyMs(uint64_t ms) {
+    uint64_t now  = NowNs();
+    uint64_t last = m_last.load(std::memory_order_relaxed);
+    if ((last == 0 || now - last >= ms * 1000000) &&
+        m_last.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+        return true;
+    }
+    return suppress();
+}
+
+bool LogLimiter::tokenBucket(double rate, uint64_t burst) {
+    return tokenBucketNs(rate > 0 ? std::max<uint64_t>(1, 1e9 / rate) : 0, burst);
+}
+
+bool LogLimiter::tokenBucketNs(uint64_t interval, uint64_t burst) {
+    uint64_t now = NowNs();
+    if (interval == 0) {
+        return pass(now);
+    }
+    // GCRA: 理论到达时间超前当前时间不超过burst个令牌间隔时放行，只需要一个原子变量
+    uint64_t limit = interval * (burst ? burst : 1);
+    uint64_t tat   = m_tat.load(std::memory_order_relaxed);
+    for (;;) {
+        uint64_t next = std::max(tat, now) + interval;
+        if (next - now > limit) {
+            return suppress();
+        }
+        if (m_tat.compare_exchange_weak(tat, next, std::memory_order_relaxed)) {
+            return pass(now);
+        }
+    }
+}
+
+LogStream& LogLimiter::prefix(LogStream& ss) {
+    if (uint64_t suppressed = takeSuppressed()) {
+        ss << "[suppressed " << suppressed << "] ";
+    }
+    return ss;
+}
+
+void Logger::setFormatter(LogFormatter::ptr val) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_formatter.store(val);
+
+    RcuValue<std::vector<LogAppender::ptr>>::ReadLock appenders(m_appenders);
+    for (auto& i : *appenders) {
+        inheritFormatter(i, val);
+    }
+}
+void Logger::setFormatter(const std::string& val) {
+    mylog::LogFormatter::ptr new_val = LogFormatter::Create(val);
+    if (new_val->isError()) {
+        std::cout << "Logger setFormatter name = " << m_name << "value = " << val << " invalid formatter "
+                  << "\n";
+        return;
+    }
+    // m_formatter = new_val;
+    setFormatter(new_val);
+}
+LogFormatter::ptr Logger::getFormatter() { return m_formatter.load(); }
+
+std::string Logger::toYamlString() {
+    YAML::Node node;
+    node["name"] = m_name;
+    if (m_level != LogLevel::UNKNOWN) {
+        node["level"] = LogLevel::ToString(m_level);
+    }
+    LogFormatter::ptr formatter = m_formatter.load();
+    if (formatter) {
+        node["formatter"] = formatter->getPattern();
+    }
+    if (getRateLimit() > 0) {
+        node["rate_limit"]["rate"]  = getRateLimit();
+        node["rate_limit"]["burst"] = getRateBurst();
+    }
+
+    for (auto& i : m_appenders.load()) {
+        node["appenders"].push_back(YAML::Load(i->toYamlString()));
+    }
+    std::stringstream ss;
+    ss << node;
+    return ss.str();
+}
+
+//  Logger::志级别方法
+void Logger::debug(LogEvent::ptr event) { log(LogLevel::DEBUG, event); }
+void Logger::info(LogEvent::ptr event) { log(LogLevel::INFO, event); }
+void Logger::warn(LogEvent::ptr event) { log(LogLevel::WARN, event); }
+void Logger::error(LogEvent::ptr event) { log(LogLevel::ERROR, event); }
+void Logger::fatal(LogEvent::ptr event) { log(LogLevel::FATAL, event); }
+
+// 每个线程复用的格式化缓冲区，避免每条日志都申请内存
+static std::string& GetFormatBuffer() {
+    static thread_local std::string s_buffer;
+    s_buffer.clear();
+    return s_buffer;
+}
+
+// TODO reopen() 优化
+FileLogAppender::FileLogAppender(const std::string& filename) : m_filename(filename) {
+    // 默认ERROR及以上的日志立即写入，进程崩溃时不会丢失
+    LogFlushPolicy policy;
+    policy.level = LogLevel::ERROR;
+    setFlushPolicy(policy);
+    reopen();
+}
+
+void FileLogAppender::log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) {
+    if (level >= m_level) {
+        std::string& buf = GetFormatBuffer();
+        FormatterLock formatter(m_formatter);
+        formatter.get()->formatCached(buf, logger, level, event);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_filestream.write(buf.data(), buf.size());
+        if (FlushAction action = flushAction(level)) {
+            m_filestream.flush();
+            if (action == FLUSH_SYNC) {
+                SyncFile(m_filename);
+            }
+        }
+    }
+}
+
+void FileLogAppender::logBatch(Logger::ptr logger, const LogEvent::ptr* events, size_t count) {
+    std::string& buf   = GetFormatBuffer();
+    FlushAction action = FLUSH_NONE;
+    {
+        FormatterLock formatter(m_formatter);
+        for (size_t i = 0; i < count; ++i) {
+            LogLevel::Level level = events[i]->getLevel();
+            if (level >= m_level) {
+                formatter.get()->formatCached(buf, logger, level, events[i]);
+                action = std::max(action, flushAction(level));
+            }
+        }
+    }
+    if (buf.empty()) {
+        return;
+    }
+    // 超过文件流缓冲区的内容由文件流直接写入(libstdc++将缓冲区中的内容与之合并为一次writev)
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_filestream.write(buf.data(), buf.size());
+    if (action) {
+        m_filestream.flush();
+        if (action == FLUSH_SYNC) {
+            SyncFile(m_filename);
+        }
+    }
+}
+
+std::string FileLogAppender::toYamlString() {
+    YAML::Node node;
+    node["type"] = "FileLogAppender";
+    node["file"] = m_filename;
+    if (m_level != LogLevel::UNKNOWN) {
+        node["level"] = LogLevel::ToString(m_level);
+    }
+    LogFormatter::ptr formatter = getFormatter();
+    if (m_hasFormatter && formatter) {
+        node["formatter"] = formatter->getPattern();
+    }
+    flushPolicyToYaml(node);
+    std::stringstream ss;
+    ss << node;
+    return ss.str();
+}
+
+void FileLogAppender::flushWrite() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_filestream.flush();
+}
+
+bool FileLogAppender::reopen() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // 重复打开的文件就先打开再关闭
+    if (m_filestream) {
+        m_filestream.close();
+    }
+    // 追加写入，重复打开时不清空之前的日志
+    m_filestream.open(m_filename, std::ios::out | std::ios::app);
+    // !! 可以将非0转1， 0保持
+    return !!m_filestream;
+}
+
+const char* MmapFileLogAppender::SyncToString(SyncPolicy policy) {
+    switch (policy) {
+        case SYNC_ASYNC:
+            return "async";
+        case SYNC_SYNC:
+            return "sync";
+        default:
+            return "none";
+    }
+}
+
+MmapFileLogAppender::SyncPolicy MmapFileLogAppender::SyncFromString(const std::string& str) {
+    if (str == "async" || str == "ASYNC") {
+        return SYNC_ASYNC;
+    }
+    if (str == "sync" || str == "SYNC") {
+        return SYNC_SYNC;
+    }
+    return SYNC_NONE;
+}
+
+MmapFileLogAppender::MmapFileLogAppender(const std::string& filename, size_t segment_size, SyncPolicy sync,
+                                         bool advise)
+    : m_filename(filename), m_sync(sync), m_advise(advise) {
+    size_t page   = sysconf(_SC_PAGESIZE);
+    m_segmentSize = std::max(page, (segment_size + page - 1) / page * page);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    openFile();
+}
+
+MmapFileLogAppender::~MmapFileLogAppender() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t end = m_base + m_pos;
+    unmapSegment();
+    if (m_fd >= 0) {
+        // 截掉预先分配但没有使用的部分
+        if (ftruncate(m_fd, end) != 0) {
+            std::cout << "MmapFileLogAppender truncate file = " << m_filename << " error: " << strerror(errno)
+                      << "\n";
+        }
+        ::close(m_fd);
+    }
+}
+
+bool MmapFileLogAppender::openFile() {
+    m_fd = ::open(m_filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        std::cout << "MmapFileLogAppender open file = " << m_filename << " error: " << strerror(errno) << "\n";
+        return false;
+    }
+    struct stat st;
+    uint64_t end = 0;
+    if (fstat(m_fd, &st) == 0) {
+        end = st.st_size;
+    }
+    // 崩溃后末尾可能是预先分配的'\0'，找到最后一个非'\0'字节
+    char buf[64 * 1024];
+    while (end > 0) {
+        size_t len = std::min<uint64_t>(end, sizeof(buf));
+        ssize_t n  = pread(m_fd, buf, len, end - len);
+        if (n != (ssize_t)len) {
+            break;
+        }
+        size_t i = len;
+        while (i > 0 && buf[i - 1] == '\0') {
+            --i;
+        }
+        end -= len - i;
+        if (i > 0) {
+            break;
+        }
+    }
+    size_t page = sysconf(_SC_PAGESIZE);
+    m_base      = end / page * page;
+    m_pos       = end - m_base;
+    return mapSegment();
+}
+
+bool MmapFileLogAppender::mapSegment() {
+    // 预先分配磁盘空间，写入映射区域时不会因为磁盘已满触发SIGBUS
+    int rt = fallocate(m_fd, 0, m_base, m_segmentSize);
+    if (rt != 0 && (errno == EOPNOTSUPP || errno == ENOSYS)) {
+        // 文件系统不支持时只扩展文件大小
+        struct stat st;
+        rt = 0;
+        if (fstat(m_fd, &st) == 0 && (uint64_t)st.st_size < m_base + m_segmentSize) {
+            rt = ftruncate(m_fd, m_base + m_segmentSize);
+        }
+    }
+    if (rt != 0) {
+        std::cout << "MmapFileLogAppender allocate file = " << m_filename << " error: " << strerror(errno) << "\n";
+        return false;
+    }
+    void* data = mmap(nullptr, m_segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, m_base);
+    if (data == MAP_FAILED) {
+        std::cout << "MmapFileLogAppender mmap file = " << m_filename << " error: " << strerror(errno) << "\n";
+        return false;
+    }
+    m_data = (char*)data;
+    if (m_advise) {
+        madvise(m_data, m_segmentSize, MADV_SEQUENTIAL);
+    }
+    return true;
+}
+
+void MmapFileLogAppender::unmapSegment() {
+    if (!m_data) {
+        return;
+    }
+    if (m_sync != SYNC_NONE) {
+        msync(m_data, m_segmentSize, m_sync == SYNC_SYNC ? MS_SYNC : MS_ASYNC);
+    }
+    if (m_advise) {
+        // 只释放进程的映射，脏页仍然由内核写回
+        madvise(m_data, m_segmentSize, MADV_DONTNEED);
+    }
+    munmap(m_data, m_segmentSize);
+    m_data = nullptr;
+}
+
+void MmapFileLogAppender::append(const char* data, size_t len) {
+    while (len > 0) {
+        if (m_data && m_pos == m_segmentSize) {
+            unmapSegment();
+            m_base += m_segmentSize;
+            m_pos = 0;
+            mapSegment();
+        }
+        if (!m_data) {
+            // 映射失败(已经输出过错误)后不再映射，改用pwrite从当前位置继续写入，文件中不会留下空洞
+            while (m_fd >= 0 && len > 0) {
+                ssize_t n = pwrite(m_fd, data, len, m_base + m_pos);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    // 写入失败时丢弃
+                    return;
+                }
+                m_pos += n;
+                data += n;
+                len -= n;
+            }
+            return;
+        }
+        size_t n = std::min(len, m_segmentSize - m_pos);
+        memcpy(m_data + m_pos, data, n);
+        m_pos += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void MmapFileLogAppender::log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) {
+    if (level >= m_level) {
+        std::string& buf = GetFormatBuffer();
+        {
+            FormatterLock formatter(m_formatter);
+            formatter.get()->formatCached(buf, logger, level, event);
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        append(buf.data(), buf.size());
+        // 写入映射区域后数据已经在页缓存中，只有同步到磁盘需要处理
+        if (flushAction(level) == FLUSH_SYNC) {
+            sync();
+        }
+    }
+}
+
+void MmapFileLogAppender::sync() {
+    if (m_data && m_pos) {
+        msync(m_data, m_pos, MS_SYNC);
+    } else if (!m_data && m_fd >= 0) {
+        fdatasync(m_fd);
+    }
+}
+
+void MmapFileLogAppender::flush() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    sync();
+}
+
+std::string MmapFileLogAppender::toYamlString() {
+    YAML::Node node;
+    node["type"]         = "MmapFileLogAppender";
+    node["file"]         = m_filename;
+    node["segment_size"] = m_segmentSize;
+    node["sync"]         = SyncToString(m_sync);
+    node["advise"]       = m_advise;
+    if (m_level != LogLevel::UNKNOWN) {
+        node["level"] = LogLevel::ToString(m_level);
+    }
+    LogFormatter::ptr formatter = getFormatter();
+    if (m_hasFormatter && formatter) {
+        node["formatter"] = formatter->getPattern();
+    }
+    flushPolicyToYaml(node);
+    std::stringstream ss;
+    ss << node;
+    return ss.str();
+}
+
+// 收到的SIGHUP次数，RollingFileLogAppender输出日志时发现变化就重新打开文件
+static std::atomic<uint64_t> s_sighupCount{0};
+static struct sigaction s_oldSighupAction;
+
+static void OnSighup(int sig, siginfo_t* info, void* context) {
+    s_sighupCount.fetch_add(1, std::memory_order_relaxed);
+    // 继续调用原来的处理函数
+    if (s_oldSighupAction.sa_flags & SA_SIGINFO) {
+        if (s_oldSighupAction.sa_sigaction) {
+            s_oldSighupAction.sa_sigaction(sig, info, context);
+        }
+    } else if (s_oldSighupAction.sa_handler != SIG_DFL && s_oldSighupAction.sa_handler != SIG_IGN) {
+        s_oldSighupAction.sa_handler(sig);
+    }
+}
+
+static void InstallSighupHandler() {
+    static std::once_flag s_once;
+    std::call_once(s_once, []() {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_sigaction = OnSighup;
+        action.sa_flags     = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGHUP, &action, &s_oldSighupAction);
+    });
+}
+
+// 按照时间切换时，time所在周期结束的时间
+static time_t NextRollTime(RollingFileLogAppender::RollInterval interval, time_t time) {
+    if (interval == RollingFileLogAppender::NONE) {
+        return 0;
+    }
+    struct tm tm;
+    localtime_r(&time, &tm);
+    tm.tm_sec = 0;
+    tm.tm_min = 0;
+    if (interval == RollingFileLogAppender::HOURLY) {
+        tm.tm_hour += 1;
+    } else {
+        tm.tm_hour = 0;
+        tm.tm_mday += 1;
+    }
+    tm.tm_isdst = -1;
+    return mktime(&tm);
+}
+
+const char* RollingFileLogAppender::IntervalToString(RollInterval interval) {
+    switch (interval) {
+        case HOURLY:
+            return "hourly";
+        case DAILY:
+            return "daily";
+        default:
+            return "none";
+    }
+}
+
+RollingFileLogAppender::RollInterval RollingFileLogAppender::IntervalFromString(const std::string& str) {
+    if (str == "hourly" || str == "HOURLY") {
+        return HOURLY;
+    }
+    if (str == "daily" || str == "DAILY") {
+        return DAILY;
+    }
+    return NONE;
+}
+
+RollingFileLogAppender::RollingFileLogAppender(const std::string& filename, uint64_t max_size, RollInterval interval,
+                                               uint32_t max_files, bool compress)
+    : m_filename(filename), m_maxSize(max_size), m_interval(interval), m_maxFiles(max_files), m_compress(compress) {
+    InstallSighupHandler();
+    m_sighupSeq = s_sighupCount.load(std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        openFile();
+    }
+    m_thread = std::thread(&RollingFileLogAppender::run, this);
+}
+
+RollingFileLogAppender::~RollingFileLogAppender() {
+    {
+        std::lock_guard<std::mutex> lock(m_archiveMutex);
+        m_stopping = true;
+    }
+    m_archiveCond.notify_all();
+    // 后台线程处理完已经切换的归档后退出
+    m_thread.join();
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+bool RollingFileLogAppender::openFile() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+    m_fd = ::open(m_filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        std::cout << "RollingFileLogAppender open file = " << m_filename << " error: " << strerror(errno) << "\n";
+        m_size     = 0;
+        m_nextRoll = NextRollTime(m_interval, time(0));
+        return false;
+    }
+    struct stat st;
+    time_t begin = time(0);
+    m_size       = 0;
+    if (fstat(m_fd, &st) == 0) {
+        m_size = st.st_size;
+        // 已有的文件按照最后修改时间计算，重启后上一个周期的日志不会与当前周期混在一起
+        if (m_size > 0) {
+            begin = st.st_mtime;
+        }
+    }
+    m_nextRoll = NextRollTime(m_interval, begin);
+    return true;
+}
+
+void RollingFileLogAppender::rollFile(time_t now) {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    if (now == m_lastRoll) {
+        ++m_rollSeq;
+    } else {
+        m_lastRoll = now;
+        m_rollSeq  = 0;
+    }
+    struct tm tm;
+    localtime_r(&now, &tm);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+    std::string archive;
+    while (true) {
+        archive = m_filename + "." + stamp + "." + std::to_string(m_rollSeq);
+        // 重启后同一秒内的归档可能已经存在
+        if (access(archive.c_str(), F_OK) != 0 && access((archive + ".gz").c_str(), F_OK) != 0) {
+            break;
+        }
+        ++m_rollSeq;
+    }
+    if (::rename(m_filename.c_str(), archive.c_str()) == 0) {
+        {
+            std::lock_guard<std::mutex> lock(m_archiveMutex);
+            m_archives.push_back(archive);
+        }
+        m_archiveCond.notify_all();
+    } else if (errno != ENOENT) {
+        std::cout << "RollingFileLogAppender rename file = " << m_filename << " error: " << strerror(errno) << "\n";
+    }
+    openFile();
+}
+
+void RollingFileLogAppender::log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) {
+    if (level < m_level) {
+        return;
+    }
+    std::string& buf = GetFormatBuffer();
+    {
+        FormatterLock formatter(m_formatter);
+        formatter.get()->formatCached(buf, logger, level, event);
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t sighup = s_sighupCount.load(std::memory_order_relaxed);
+    if (MYLOG_UNLIKELY(sighup != m_sighupSeq)) {
+        m_sighupSeq = sighup;
+        openFile();
+    }
+    time_t now = event->getTime();
+    if ((m_nextRoll && now >= m_nextRoll) || (m_maxSize && m_size && m_size + buf.size() > m_maxSize)) {
+        rollFile(now);
+    }
+    if (m_fd < 0) {
+        return;
+    }
+    const char* data = buf.data();
+    size_t len       = buf.size();
+    while (len > 0) {
+        ssize_t n = ::write(m_fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cout << "RollingFileLogAppender write file = " << m_filename << " error: " << strerror(errno)
+                      << "\n";
+            return;
+        }
+        data += n;
+        len -= n;
+        m_size += n;
+    }
+    // 直接write没有用户态缓冲，只有同步到磁盘需要处理
+    if (flushAction(level) == FLUSH_SYNC) {
+        fdatasync(m_fd);
+    }
+}
+
+bool RollingFileLogAppender::reopen() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return openFile();
+}
+
+void RollingFileLogAppender::rollover() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    rollFile(time(0));
+}
+
+void RollingFileLogAppender::waitArchived() {
+    std::unique_lock<std::mutex> lock(m_archiveMutex);
+    m_archiveCond.wait(lock, [this]() { return m_archives.empty() && m_archiving == 0; });
+}
+
+void RollingFileLogAppender::run() {
+    std::unique_lock<std::mutex> lock(m_archiveMutex);
+    while (true) {
+        m_archiveCond.wait(lock, [this]() { return m_stopping || !m_archives.empty(); });
+        if (m_archives.empty()) {
+            break;
+        }
+        std::vector<std::string> archives;
+        archives.swap(m_archives);
+        m_archiving = archives.size();
+        lock.unlock();
+
+        if (m_compress) {
+            for (auto& i : archives) {
+                compressFile(i);
+            }
+        }
+        if (m_maxFiles) {
+            removeOldFiles();
+        }
+
+        lock.lock();
+        m_archiving = 0;
+        m_archiveCond.notify_all();
+    }
+}
+
+void RollingFileLogAppender::compressFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::cout << "RollingFileLogAppender open file = " << path << " error: " << strerror(errno) << "\n";
+        return;
+    }
+    // 先写入临时文件，压缩完成后再改名，中途退出不会留下不完整的.gz
+    std::string tmp = path + ".gz.tmp";
+    gzFile gz       = gzopen(tmp.c_str(), "wb6");
+    if (!gz) {
+        std::cout << "RollingFileLogAppender gzopen file = " << tmp << " failed\n";
+        ::close(fd);
+        return;
+    }
+    bool ok = true;
+    char buf[64 * 1024];
+    while (true) {
+        ssize_t n = ::read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            ok = n == 0;
+            break;
+        }
+        if (gzwrite(gz, buf, n) != n) {
+            ok = false;
+            break;
+        }
+    }
+    ::close(fd);
+    if (gzclose(gz) != Z_OK) {
+        ok = false;
+    }
+    if (ok && ::rename(tmp.c_str(), (path + ".gz").c_str()) == 0) {
+        ::unlink(path.c_str());
+    } else {
+        std::cout << "RollingFileLogAppender compress file = " << path << " failed\n";
+        ::unlink(tmp.c_str());
+    }
+}
+
+void RollingFileLogAppender::removeOldFiles() {
+    size_t pos       = m_filename.rfind('/');
+    std::string dir  = pos == std::string::npos ? "." : m_filename.substr(0, pos + 1);
+    std::string base = (pos == std::string::npos ? m_filename : m_filename.substr(pos + 1)) + ".";
+    DIR* d           = opendir(dir.c_str());
+    if (!d) {
+        return;
+    }
+    // (时间, 序号, 文件名)
+    std::vector<std::tuple<std::string, uint32_t, std::string>> archives;
+    while (struct dirent* entry = readdir(d)) {
+        std::string name = entry->d_name;
+        if (name.compare(0, base.size(), base) != 0) {
+            continue;
+        }
+        // 只处理 YYYYmmdd-HHMMSS.序号[.gz]
+        std::string rest = name.substr(base.size());
+        if (rest.size() > 3 && rest.compare(rest.size() - 3, 3, ".gz") == 0) {
+            rest.resize(rest.size() - 3);
+        }
+        if (rest.size() < 17 || rest[8] != '-' || rest[15] != '.') {
+            continue;
+        }
+        std::string stamp = rest.substr(0, 15);
+        std::string seq   = rest.substr(16);
+        if (std::count_if(stamp.begin(), stamp.end(), ::isdigit) != 14 ||
+            !std::all_of(seq.begin(), seq.end(), ::isdigit)) {
+            continue;
+        }
+        // 目录中可能有同名格式但序号超长的文件，解析失败时跳过(不能在后台线程抛出异常)
+        errno                  = 0;
+        unsigned long long num = strtoull(seq.c_str(), nullptr, 10);
+        if (errno == ERANGE || num > UINT32_MAX) {
+            continue;
+        }
+        archives.emplace_back(stamp, static_cast<uint32_t>(num), dir + name);
+    }
+    closedir(d);
+    if (archives.size() <= m_maxFiles) {
+        return;
+    }
+    std::sort(archives.begin(), archives.end());
+    for (size_t i = 0; i < archives.size() - m_maxFiles; ++i) {
+        ::unlink(std::get<2>(archives[i]).c_str());
+    }
+}
+
+std::string RollingFileLogAppender::toYamlString() {
+    YAML::Node node;
+    node["type"] = "RollingFileLogAppender";
+    node["file"] = m_filename;
+    if (m_maxSize) {
+        node["max_size"] = m_maxSize;
+    }
+    node["roll"] = IntervalToString(m_interval);
+    if (m_maxFiles) {
+        node["max_files"] = m_maxFiles;
+    }
+    if (m_compress) {
+        node["compress"] = true;
+    }
+    if (m_level != LogLevel::UNKNOWN) {
+        node["level"] = LogLevel::ToString(m_level);
+    }
+    LogFormatter::ptr formatter = getFormatter();
+    if (m_hasFormatter && formatter) {
+        node["formatter"] = formatter->getPattern();
+    }
+    flushPolicyToYaml(node);
+    std::stringstream ss;
+    ss << node;
+    return ss.str();
+}
+StdoutLogAppender::StdoutLogAppender() {
+    // 默认ERROR及以上的日志立即写入
+    LogFlushPolicy policy;
+    policy.level = LogLevel::ERROR;
+    setFlushPolicy(policy);
+}
+
+void StdoutLogAppender::flushWrite() { std::cout.flush(); }
+
+void StdoutLogAppender::log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) {
+    if (level >= m_level) {
+        std::string& buf = GetFormatBuffer();
+        FormatterLock formatter(m_formatter);
+        formatter.get()->formatCached(buf, logger, level, event);
+        std::cout.write(buf.data(), buf.size());
+        if (FlushAction action = flushAction(level)) {
+            std::cout.flush();
+            if (action == FLUSH_SYNC) {
+                // 标准输出重定向到文件时有效
+                fdatasync(STDOUT_FILENO);
+            }
+        }
+    }
+}
+
+void StdoutLogAppender::logBatch(Logger::ptr logger, const LogEvent::ptr* events, size_t count) {
+    std::string& buf   = GetFormatBuffer();
+    FlushAction action = FLUSH_NONE;
+    {
+        FormatterLock formatter(m_formatter);
+        for (size_t i = 0; i < count; ++i) {
+            LogLevel::Level level = events[i]->getLevel();
+            if (level >= m_level) {
+                formatter.get()->formatCached(buf, logger, level, events[i]);
+                action = std::max(action, flushAction(level));
+            }
+        }
+    }
+    if (buf.empty()) {
+        return;
+    }
+    std::cout.write(buf.data(), buf.size());
+    if (action) {
+        std::cout.flush();
+        if (action == FLUSH_SYNC) {
+            fdatasync(STDOUT_FILENO);
+        }
+    }
+}
+
+std::string StdoutLogAppender::toYamlString() {
+    YAML::Node node;
+    node["type"] = "StdoutLogAppender";
+    if (m_level != LogLevel::UNKNOWN) {
+        node["level"] = LogLevel::ToString(m_level);
+    }
+    LogFormatter::ptr formatter = getFormatter();
+    if (m_hasFormatter && formatter) {
+        node["formatter"] = formatter->getPattern();
+    }
+    flushPolicyToYaml(node);
+    std::stringstream ss;
+    ss << node;
+    return ss.str();
+}
+
+const char* AsyncLogAppender::PolicyToString(FullPolicy policy) {
+    switch (policy) {
+        case BLOCK:
+            return "block";
+        case DROP:
+            return "drop";
+        case DROP_COUNT:
+            return "drop_count";
+    }
+    return "block";
+}
+
+AsyncLogAppender::FullPolicy AsyncLogAppender::PolicyFromString(const std::string& str) {
+    if (str == "drop" || str == "DROP") {
+        return DROP;
+    }
+    if (str == "drop_count" || str == "DROP_COUNT") {
+        return DROP_COUNT;
+    }
+    return BLOCK;
+}
+
+AsyncLogAppender::AsyncLogAppender(const std::string& filename, size_t buffer_size, uint32_t flush_interval,
+                                   FullPolicy policy, bool defer, bool uring)
+    : m_filename(filename),
+      m_bufferSize(buffer_size ? buffer_size : 4 * 1024 * 1024),
+      m_flushInterval(flush_interval ? flush_interval : 1000),
+      m_policy(policy),
+      m_defer(defer),
+      m_uring(uring) {
+    // 追加写入，避免重复打开时清空之前的日志
+    m_fd = ::open(m_filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        std::cout << "AsyncLogAppender open file = " << m_filename << " error: " << strerror(errno) << "\n";
+    }
+    if (!m_defer) {
+        m_front.text.reserve(m_bufferSize);
+        m_back.text.reserve(m_bufferSize);
+    }
+    m_thread = std::thread(&AsyncLogAppender::run, this);
+}
+
+AsyncLogAppender::~AsyncLogAppender() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cond.notify_one();
+    m_thread.join();
+    if (m_fd >= 0) {
+        if (m_uring) {
+            // 取消固定文件注册后才能关闭
+            LogIoService::GetInstance()->release(m_fd);
+        }
+        ::close(m_fd);
+    }
+}
+
+void AsyncLogAppender::log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) {
+    if (level < m_level) {
+        return;
+    }
+    std::string& msg = GetFormatBuffer();
+    size_t bytes     = 0;
+    if (m_defer) {
+        // 只估算事件占用的内存，格式化交给后台线程
+        bytes = sizeof(LogEvent) + event->getArgs().size() + event->getSS().size();
+    } else {
+        // 格式化放在锁外
+        FormatterLock formatter(m_formatter);
+        formatter.get()->formatCached(msg, logger, level, event);
+        bytes = msg.size();
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // 前台缓冲区为空时总是允许写入，保证超长日志不会丢失
+    while (!m_front.empty() && m_front.bytes + bytes > m_bufferSize) {
+        // 前台写满，唤醒后台线程交换缓冲区(前台可能还没有达到m_bufferSize，需要设置m_flushRequest)
+        m_flushRequest = true;
+        m_cond.notify_one();
+        if (m_policy == BLOCK) {
+            m_doneCond.wait(lock);
+            continue;
+        }
+        if (m_policy == DROP_COUNT) {
+            ++m_dropped;
+        }
+        return;
+    }
+    if (m_defer) {
+        m_front.events.push_back(std::make_pair(level, event));
+    } else {
+        m_front.text.append(msg);
+    }
+    m_front.bytes += bytes;
+    FlushAction action = flushAction(level);
+    if (action != FLUSH_NONE) {
+        // 立即唤醒后台线程写入，不等待缓冲区写满或者flush_interval
+        m_flushRequest = true;
+        m_cond.notify_one();
+    } else if (m_front.bytes >= m_bufferSize) {
+        m_cond.notify_one();
+    }
+    if (action == FLUSH_SYNC) {
+        lock.unlock();
+        flush();
+        if (m_fd >= 0) {
+            fdatasync(m_fd);
+        }
+    }
+}
+
+void AsyncLogAppender::flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // 前台有数据时需要等到下一次交换写完，否则等当前正在写入的缓冲区写完
+    uint64_t target = m_front.empty() ? m_swapSeq : m_swapSeq + 1;
+    m_flushRequest  = true;
+    m_cond.notify_one();
+    while (m_writtenSeq < target) {
+        m_doneCond.wait(lock);
+    }
+}
+
+void AsyncLogAppender::writeAll(const char* data, size_t len) {
+    if (m_fd < 0) {
+        return;
+    }
+    if (m_uring) {
+        // 复制到LogIoService的缓冲区后返回，完成后再更新m_writtenSeq
+        m_ioSeq = LogIoService::GetInstance()->write(m_fd, data, len);
+        return;
+    }
+    while (len > 0) {
+        ssize_t n = ::write(m_fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cout << "AsyncLogAppender write file = " << m_filename << " error: " << strerror(errno) << "\n";
+            return;
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+void AsyncLogAppender::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        // 等待前台写满、flush请求、超时或者退出
+        m_cond.wait_for(lock, std::chrono::milliseconds(m_flushInterval), [this]() {
+            return m_stopping || m_flushRequest || m_front.bytes >= m_bufferSize;
+        });
+        m_flushRequest = false;
+        if (m_front.empty()) {
+            if (m_stopping) {
+                break;
+            }
+            continue;
+        }
+        // 交换前后台缓冲区，之后生产者可以继续写入新的前台缓冲区
+        m_front.swap(m_back);
+        uint64_t seq     = ++m_swapSeq;
+        uint64_t dropped = m_dropped;
+        m_doneCond.notify_all();
+        lock.unlock();
+
+        // defer模式下在后台线程完成格式化
+        if (!m_back.events.empty()) {
+            FormatterLock formatter(m_formatter);
+            for (auto& i : m_back.events) {
+                formatter.get()->format(m_back.text, i.second->getLogger(), i.first, i.second);
+            }
+        }
+        writeAll(m_back.text.data(), m_back.text.size());
+        if (dropped != m_reportedDropped) {
+            std::stringstream ss;
+            ss << "AsyncLogAppender " << m_filename << " dropped " << dropped - m_reportedDropped << " logs\n";
+            std::string tip = ss.str();
+            writeAll(tip.data(), tip.size());
+            m_reportedDropped = dropped;
+        }
+        m_back.clear();
+        if (m_uring) {
+            LogIoService::GetInstance()->wait(m_ioSeq);
+        }
+
+        lock.lock();
+        m_writtenSeq = seq;
+        m_doneCond.notify_all();
+    }
+    m_writtenSeq = m_swapSeq;
+    m_doneCond.notify_all();
+}
+
+std::string AsyncLogAppender::toYamlString() {
+    YAML::Node node;
+    node["type"]           = "AsyncLogAppender";
+    node["file"]           = m_filename;
+    node["buffer_size"]    = m_bufferSize;
+    node["flush_interval"] = m_flushInterval;
+    node["full_policy"]    = PolicyToString(m_policy);
+    if (m_defer) {
+        node["defer"] = true;
+    }
+    if (m_uring) {
+        node["io"] = "uring";
+    }
+    if (m_level != LogLevel::UNKNOWN) {
+        node["level"] = LogLevel::ToString(m_level);
+    }
+    LogFormatter::ptr formatter = getFormatter();
+    if (m_hasFormatter && formatter) {
+        node["formatter"] = formatter->getPattern();
+    }
+    flushPolicyToYaml(node);
+    std::stringstream ss;
+    ss << node;
+    return ss.str();
+}
+
+// 单生产者单消费者的环形缓冲区
+// 由固定大小的槽组成，一条日志占用连续的若干个槽：首个槽以Header开头，其后紧跟日志内容
+// 生产者只写m_head，消费者只写m_tail，两者都不会等待对方
+class LogRing {
+   public:
+    typedef std::shared_ptr<LogRing> ptr;
+    static const size_t kSlotSize = 64;
+    // 填充记录的时间戳，用于跳过环尾放不下一条完整日志的槽
+    static const uint64_t kPadding = ~0ull;
+
+    struct Header {
+        // 单调时钟时间戳(纳秒)
+        uint64_t time;
+        // 日志内容长度
+        uint32_t len;
+        // 占用的槽数
+        uint32_t slots;
+    };
+
+    LogRing(uint32_t thread_id, size_t bytes) : m_threadId(thread_id) {
+        size_t count = 16;
+        while (count * kSlotSize < bytes) {
+            count <<= 1;
+        }
+        m_count = count;
+        m_mask  = count - 1;
+        m_data.reset(new char[count * kSlotSize]);
+    }
+
+    uint32_t getThreadId() const { return m_threadId; }
+    uint64_t getOverflow() const { return m_overflow.load(std::memory_order_relaxed); }
+    bool empty() const {
+        return m_tail.load(std::memory_order_relaxed) == m_head.load(std::memory_order_acquire);
+    }
+
+    // 生产者：写入一条日志，空间不足时丢弃并计数
+    bool push(uint64_t time, const char* data, size_t len) {
+        size_t need   = (sizeof(Header) + len + kSlotSize - 1) / kSlotSize;
+        uint64_t head = m_head.load(std::memory_order_relaxed);
+        size_t idx    = head & m_mask;
+        // 环尾剩余的槽放不下时，先用一条填充记录占满环尾，再从头开始写
+        size_t pad    = (m_count - idx < need) ? m_count - idx : 0;
+        if (need > m_count || !reserve(head, pad + need)) {
+            m_overflow.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (pad) {
+            Header* h = header(idx);
+            h->time   = kPadding;
+            h->len    = 0;
+            h->slots  = pad;
+            head += pad;
+            idx = 0;
+        }
+        Header* h = header(idx);
+        h->time   = time;
+        h->len    = len;
+        h->slots  = need;
+        memcpy(h + 1, data, len);
+        m_head.store(head + need, std::memory_order_release);
+        return true;
+    }
+
+    // 消费者：查看最早的一条日志，没有时返回nullptr
+    const Header* peek() {
+        uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        uint64_t head = m_head.load(std::memory_order_acquire);
+        while (tail != head) {
+            Header* h = header(tail & m_mask);
+            if (h->time != kPadding) {
+                return h;
+            }
+            tail += h->slots;
+            m_tail.store(tail, std::memory_order_release);
+        }
+        return nullptr;
+    }
+
+    // 消费者：释放peek得到的日志
+    void pop(const Header* h) {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + h->slots, std::memory_order_release);
+    }
+
+   private:
+    Header* header(size_t idx) { return reinterpret_cast<Header*>(m_data.get() + idx * kSlotSize); }
+
+    bool reserve(uint64_t head, size_t slots) {
+        if (head + slots - m_cachedTail <= m_count) {
+            return true;
+        }
+        m_cachedTail = m_tail.load(std::memory_order_acquire);
+        return head + slots - m_cachedTail <= m_count;
+    }
+
+   private:
+    uint32_t m_threadId;
+    size_t m_count;
+    size_t m_mask;
+    std::unique_ptr<char[]> m_data;
+    // 生产者与消费者使用的变量分开放在不同的缓存行，避免伪共享
+    char m_pad0[64];
+    std::atomic<uint64_t> m_head{0};
+    // 生产者缓存的消费位置，减少对m_tail的读取
+    uint64_t m_cachedTail = 0;
+    std::atomic<uint64_t> m_overflow{0};
+    char m_pad1[64];
+    std::atomic<uint64_t> m_tail{0};
+};
+
+static uint64_t GetMonotonicNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// 线程局部的环形缓冲区表
+struct ThreadRingEntry {
+    std::weak_ptr<char> token;
+    LogRing::ptr ring;
+};
+static thread_local std::unordered_map<uint64_t, ThreadRingEntry> t_rings;
+static std::atomic<uint64_t> s_ring_appender_id{0};
+
+RingLogAppender::RingLogAppender(const std::string& filename, size_t ring_size, uint32_t flush_interval)
+    : m_filename(filename),
+      m_ringSize(ring_size ? ring_size : 1024 * 1024),
+      m_flushInterval(flush_interval ? flush_interval : 10),
+      m_id(++s_ring_appender_id),
+      m_token(new char(0)) {
+    if (m_filename.empty()) {
+        m_fd = STDOUT_FILENO;
+    } else {
+        m_fd = ::open(m_filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (m_fd < 0) {
+            std::cout << "RingLogAppender open file = " << m_filename << " error: " << strerror(errno) << "\n";
+        }
+    }
+    m_thread = std::thread(&RingLogAppender::run, this);
+}
+
+RingLogAppender::~RingLogAppender() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cond.notify_all();
+    m_thread.join();
+    if (m_fd >= 0 && m_fd != STDOUT_FILENO) {
+        ::close(m_fd);
+    }
+}
+
+LogRing* RingLogAppender::getRing() {
+    auto it = t_rings.find(m_id);
+    if (it != t_rings.end()) {
+        return it->second.ring.get();
+    }
+    // 清理已经析构的appender留下的缓冲区
+    for (auto i = t_rings.begin(); i != t_rings.end();) {
+        if (i->second.token.expired()) {
+            i = t_rings.erase(i);
+        } else {
+            ++i;
+        }
+    }
+    LogRing::ptr ring(new LogRing(GetThreadId(), m_ringSize));
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_rings.push_back(ring);
+    }
+    ThreadRingEntry& entry = t_rings[m_id];
+    entry.token            = m_token;
+    entry.ring             = ring;
+    return ring.get();
+}
+
+void RingLogAppender::log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) {
+    if (level >= m_level) {
+        std::string& msg = GetFormatBuffer();
+        FormatterLock formatter(m_formatter);
+        formatter.get()->formatCached(msg, logger, level, event);
+        getRing()->push(GetMonotonicNs(), msg.data(), msg.size());
+        if (FlushAction action = flushAction(level)) {
+            // 等待消费线程写入
+            flush();
+            if (action == FLUSH_SYNC && m_fd != STDOUT_FILENO) {
+                fdatasync(m_fd);
+            }
+        }
+    }
+}
+
+void RingLogAppender::flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    uint64_t target = ++m_flushRequest;
+    m_cond.notify_all();
+    while (m_flushDone < target && !m_stopping) {
+        m_cond.wait(lock);
+    }
+}
+
+std::map<uint32_t, uint64_t> RingLogAppender::getOverflowCounts() {
+    std::map<uint32_t, uint64_t> counts;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& i : m_rings) {
+        counts[i->getThreadId()] += i->getOverflow();
+    }
+    return counts;
+}
+
+uint64_t RingLogAppender::getOverflowTotal() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t total = m_retiredOverflow;
+    for (auto& i : m_rings) {
+        total += i->getOverflow();
+    }
+    return total;
+}
+
+void RingLogAppender::writeAll(const char* data, size_t len) {
+    if (m_fd < 0) {
+        return;
+    }
+    while (len > 0) {
+        ssize_t n = ::write(m_fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cout << "RingLogAppender write file = " << m_filename << " error: " << strerror(errno) << "\n";
+            return;
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+void RingLogAppender::drain(std::vector<LogRing::ptr>& rings) {
+    std::vector<const LogRing::Header*> heads(rings.size());
+    for (size_t i = 0; i < rings.size(); ++i) {
+        heads[i] = rings[i]->peek();
+    }
+    while (true) {
+        // 多路归并：每个环形缓冲区内部已经按时间有序，每次取时间戳最小的一条
+        size_t min = rings.size();
+        for (size_t i = 0; i < rings.size(); ++i) {
+            if (heads[i] && (min == rings.size() || heads[i]->time < heads[min]->time)) {
+                min = i;
+            }
+        }
+        if (min == rings.size()) {
+            break;
+        }
+        m_out.append(reinterpret_cast<const char*>(heads[min] + 1), heads[min]->len);
+        rings[min]->pop(heads[min]);
+        heads[min] = rings[min]->peek();
+        if (m_out.size() >= 64 * 1024) {
+            writeAll(m_out.data(), m_out.size());
+            m_out.clear();
+        }
+    }
+    if (!m_out.empty()) {
+        writeAll(m_out.data(), m_out.size());
+        m_out.clear();
+    }
+}
+
+void RingLogAppender::run() {
+    std::vector<LogRing::ptr> rings;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        uint64_t request = m_flushRequest;
+        bool stopping    = m_stopping;
+        // 回收已退出线程的空缓冲区(只剩appender持有)
+        for (auto it = m_rings.begin(); it != m_rings.end();) {
+            if (it->use_count() == 1 && (*it)->empty()) {
+                m_retiredOverflow += (*it)->getOverflow();
+                it = m_rings.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        rings = m_rings;
+        lock.unlock();
+
+        drain(rings);
+        rings.clear();
+
+        lock.lock();
+        m_flushDone = request;
+        m_cond.notify_all();
+        if (stopping) {
+            break;
+        }
+        if (m_flushRequest == request && !m_stopping) {
+            m_cond.wait_for(lock, std::chrono::milliseconds(m_flushInterval));
+        }
+    }
+}
+
+std::string RingLogAppender::toYamlString() {
+    YAML::Node node;
+    node["type"]           = "RingLogAppender";
+    node["file"]           = m_filename;
+    node["buffer_size"]    = m_ringSize;
+    node["flush_interval"] = m_flushInterval;
+    if (m_level != LogLevel::UNKNOWN) {
+        node["level"] = LogLevel::ToString(m_level);
+    }
+    LogFormatter::ptr formatter = getFormatter();
+    if (m_hasFormatter && formatter) {
+        node["formatter"] = formatter->getPattern();
+    }
+    flushPolicyToYaml(node);
+    std::stringstream ss;
+    ss << node;
+    return ss.str();
+}
+
+// formatter编号，从1开始
+static std::atomic<uint64_t> s_formatterId{0};
+
+LogFormatter::LogFormatter(const std::string& pattern)
+    : m_pattern(pattern), m_id(s_formatterId.fetch_add(1, std::memory_order_relaxed) + 1), m_error(false) {
+    init();
+}
+
+LogFormatter::LogFormatter(const std::string& pattern, RenderFunc render)
+    : m_pattern(pattern),
+      m_render(render),
+      m_id(s_formatterId.fetch_add(1, std::memory_order_relaxed) + 1),
+      m_error(false) {
+    init();
+}
+
+void LogFormatter::formatCached(std::string& out, const std::shared_ptr<Logger>& logger, LogLevel::Level level,
+                                const LogEvent::ptr& event) {
+    LogEvent* ev = event.get();
+    if (!ev->m_formatCache) {
+        format(out, logger, level, event);
+        return;
+    }
+    if (ev->m_formattedId != m_id || ev->m_formattedLevel != level) {
+        // 只保留最近一个formatter的结果
+        ev->m_formatted.clear();
+        format(ev->m_formatted, logger, level, event);
+        ev->m_formattedId    = m_id;
+        ev->m_formattedLevel = level;
     }
+    out.append(ev->m_formatted);
 }
 
-void Logger::addAppender(LogAppender::ptr appender) {
-    if (!appender->getFormatter()) {
-        // appender->setFormatter(m_formatter);
-        appender->m_formatter = m_formatter;
-    }
-    m_appenders.push_back(appender);
+std::string LogFormatter::format(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) {
+    std::string out;
+    format(out, logger, level, event);
+    return out;
 }
-void Logger::delAppender(LogAppender::ptr appender) {
-    for (auto it = m_appenders.begin(); it != m_appenders.end(); it++) {
-        if (*it == appender) {
-            m_appenders.erase(it);
-            break;
-        }
+
+std::string LogFormatter::formatItems(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) {
+    std::stringstream ss;
+    for (auto& i : m_items) {
+        i->format(ss, logger, level, event);
     }
+    return ss.str();
 }
 
-void Logger::clearAppenders() { m_appenders.clear(); }
-void Logger::log(LogLevel::Level level, LogEvent::ptr event) {
-    // 日志等级覆盖
-    if (level >= m_level) {
-        // 获得指向自己的指针
-        auto self = shared_from_this();
-        if (!m_appenders.empty()) {
-            for (auto& i : m_appenders) {
-                i->log(self, level, event);
+namespace {
+
+// 一种日期格式的渲染缓存
+// 格式被拆分为 strftime文本、秒(%S)、秒以下(%L/%f/%N) 三类片段，记录秒和秒以下的数字在结果中的位置
+// 同一秒内只改写秒以下的数字，同一分钟内再改写秒的两位数字，跨分钟才重新调用localtime_r/strftime
+class DateTimeCache {
+   public:
+    DateTimeCache(const char* fmt) : m_format(fmt) {
+        std::string text;
+        for (const char* p = fmt; *p; ++p) {
+            if (*p != '%' || !p[1]) {
+                text.append(1, *p);
+                continue;
+            }
+            char c = *++p;
+            if (c == 'T') {
+                // %T 等价于 %H:%M:%S
+                text.append("%H:%M:");
+                addPiece(text, SECOND);
+            } else if (c == 'S') {
+                addPiece(text, SECOND);
+            } else if (c == 'L') {
+                addPiece(text, 3);
+            } else if (c == 'f') {
+                addPiece(text, 6);
+            } else if (c == 'N') {
+                addPiece(text, 9);
+            } else {
+                // 其他依赖秒的字段(时间戳、本地化格式等)无法只改写秒，每秒重新渲染
+                if (strchr("scrX+EO", c)) {
+                    m_patchable = false;
+                }
+                text.append(1, '%').append(1, c);
             }
-        } else if (m_root) {
-            m_root->log(level, event);
         }
+        addPiece(text, TEXT);
     }
-}
 
-void Logger::setFormatter(LogFormatter::ptr val) {
-    m_formatter = val;
+    const std::string& getFormat() const { return m_format; }
 
-    for (auto& i : m_appenders) {
-        if (!i->m_hasFormatter) {
-            i->m_formatter = m_formatter;
+    void append(std::string& out, time_t time, uint32_t nsec) {
+        if (time != m_second) {
+            if (m_patchable && time >= m_minute && time < m_minute + 60) {
+                int sec = time - m_minute;
+                for (size_t pos : m_secondPos) {
+                    m_text[pos]     = '0' + sec / 10;
+                    m_text[pos + 1] = '0' + sec % 10;
+                }
+                m_second = time;
+            } else {
+                render(time);
+            }
         }
+        for (auto& i : m_fractionPos) {
+            uint32_t v = nsec;
+            for (int k = i.second; k < 9; ++k) {
+                v /= 10;
+            }
+            for (int k = i.second - 1; k >= 0; --k) {
+                m_text[i.first + k] = '0' + v % 10;
+                v /= 10;
+            }
+        }
+        out.append(m_text);
     }
-}
-void Logger::setFormatter(const std::string& val) {
-    mylog::LogFormatter::ptr new_val(new mylog::LogFormatter(val));
-    if (new_val->isError()) {
-        std::cout << "Logger setFormatter name = " << m_name << "value = " << val << " invalid formatter "
-                  << "\n";
-        return;
-    }
-    // m_formatter = new_val;
-    setFormatter(new_val);
-}
-LogFormatter::ptr Logger::getFormatter() { return m_formatter; }
 
-std::string Logger::toYamlString() {
-    YAML::Node node;
-    node["name"] = m_name;
-    if (m_level != LogLevel::UNKNOWN) {
-        node["level"] = LogLevel::ToString(m_level);
-    }
-    if (m_formatter) {
-        node["formatter"] = m_formatter->getPattern();
+   private:
+    // 片段类型，大于0时表示秒以下的位数
+    enum { TEXT = -1, SECOND = 0 };
+
+    void addPiece(std::string& text, int type) {
+        if (!text.empty()) {
+            m_pieces.push_back(std::make_pair(TEXT, text));
+            text.clear();
+        }
+        if (type != TEXT) {
+            m_pieces.push_back(std::make_pair(type, std::string()));
+        }
     }
 
-    for (auto& i : m_appenders) {
-        node["appenders"].push_back(YAML::Load(i->toYamlString()));
+    void render(time_t time) {
+        struct tm tm;
+        localtime_r(&time, &tm);  // 线程安全方法，而不是localtime
+        m_text.clear();
+        m_secondPos.clear();
+        m_fractionPos.clear();
+        for (auto& i : m_pieces) {
+            if (i.first == TEXT) {
+                char buf[128];
+                m_text.append(buf, strftime(buf, sizeof(buf), i.second.c_str(), &tm));
+            } else if (i.first == SECOND) {
+                m_secondPos.push_back(m_text.size());
+                m_text.append(1, '0' + tm.tm_sec / 10).append(1, '0' + tm.tm_sec % 10);
+            } else {
+                m_fractionPos.push_back(std::make_pair(m_text.size(), i.first));
+                m_text.append(i.first, '0');
+            }
+        }
+        m_second = time;
+        // 闰秒(tm_sec为60)时不做改写
+        m_minute = tm.tm_sec < 60 ? time - tm.tm_sec : time;
     }
-    std::stringstream ss;
-    ss << node;
-    return ss.str();
-}
 
-//  Logger::志级别方法
-void Logger::debug(LogEvent::ptr event) { log(LogLevel::DEBUG, event); }
-void Logger::info(LogEvent::ptr event) { log(LogLevel::INFO, event); }
-void Logger::warn(LogEvent::ptr event) { log(LogLevel::WARN, event); }
-void Logger::error(LogEvent::ptr event) { log(LogLevel::ERROR, event); }
-void Logger::fatal(LogEvent::ptr event) { log(LogLevel::FATAL, event); }
+   private:
+    std::string m_format;
+    std::vector<std::pair<int, std::string>> m_pieces;
+    // 除%S以外没有依赖秒的字段
+    bool m_patchable = true;
+    // 缓存的渲染结果对应的时间，以及所在分钟的起始时间
+    time_t m_second = -1;
+    time_t m_minute = -1;
+    std::string m_text;
+    std::vector<size_t> m_secondPos;
+    // 秒以下的数字的位置与位数
+    std::vector<std::pair<size_t, int>> m_fractionPos;
+};
 
-// TODO reopen() 优化
-FileLogAppender::FileLogAppender(const std::string& filename) : m_filename(filename) { reopen(); }
+}  // namespace
 
-void FileLogAppender::log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) {
-    if (level >= m_level) {
-        m_filestream << m_formatter->format(logger, level, event);
+void LogFormatter::AppendDateTime(std::string& out, const char* fmt, time_t time, uint32_t nsec) {
+    // 每个线程缓存最近使用的几种日期格式，不需要加锁
+    static thread_local std::vector<std::unique_ptr<DateTimeCache>> s_caches;
+    for (auto& i : s_caches) {
+        if (i->getFormat() == fmt) {
+            i->append(out, time, nsec);
+            return;
+        }
     }
+    if (s_caches.size() >= 8) {
+        s_caches.erase(s_caches.begin());
+    }
+    s_caches.emplace_back(new DateTimeCache(fmt));
+    s_caches.back()->append(out, time, nsec);
 }
 
-std::string FileLogAppender::toYamlString() {
-    YAML::Node node;
-    node["type"] = "FileLogAppender";
-    node["file"] = m_filename;
-    if (m_level != LogLevel::UNKNOWN) {
-        node["level"] = LogLevel::ToString(m_level);
+void LogFormatter::format(std::string& out, const std::shared_ptr<Logger>& logger, LogLevel::Level level,
+                          const LogEvent::ptr& event) {
+    if (m_render) {
+        m_render(out, level, *event);
+        return;
     }
-    if (m_hasFormatter && m_formatter) {
-        node["formatter"] = m_formatter->getPattern();
+    const LogEvent* ev = event.get();
+    for (const Op& op : m_program) {
+        switch (op.code) {
+            case OP_LITERAL:
+                out.append(m_literals.data() + op.offset, op.len);
+                break;
+            case OP_MESSAGE:
+                ev->appendContent(out);
+                break;
+            case OP_LEVEL:
+                out.append(LogLevel::ToString(level));
+                break;
+            case OP_ELAPSE:
+                AppendUInt(out, ev->getElapseNs() / op.offset);
+                break;
+            case OP_NAME:
+                out.append(ev->getLogger()->getName());
+                break;
+            case OP_THREAD_ID:
+                AppendUInt(out, ev->getThreadId());
+                break;
+            case OP_FIBER_ID:
+                AppendUInt(out, ev->getFiberId());
+                break;
+            case OP_DATETIME:
+                AppendDateTime(out, m_dateFormats[op.offset].c_str(), ev->getTime(), ev->getNsec());
+                break;
+            case OP_FILENAME:
+                out.append(ev->getFile() ? ev->getFile() : "");
+                break;
+            case OP_LINE:
+                AppendInt(out, ev->getLine());
+                break;
+            case OP_THREAD_NAME:
+                out.append(ev->getThreadName());
+                break;
+        }
     }
-    std::stringstream ss;
-    ss << node;
-    return ss.str();
 }
 
-bool FileLogAppender::reopen() {
-    // 重复打开的文件就先打开再关闭
-    if (m_filestream) {
-        m_filestream.close();
+LogFormatter::ptr LogFormatter::Create(const std::string& pattern) {
+    if (pattern == JsonFormatter::kName) {
+        return LogFormatter::ptr(new JsonFormatter);
     }
-    m_filestream.open(m_filename);
-    // !! 可以将非0转1， 0保持
-    return !!m_filestream;
+    return LogFormatter::ptr(new LogFormatter(pattern));
 }
-void StdoutLogAppender::log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) {
-    if (level >= m_level) {
-        std::cout << m_formatter->format(logger, level, event);
+
+void JsonFormatter::AppendEscaped(std::string& out, const char* data, size_t len) {
+    static const char* kHex = "0123456789abcdef";
+    const char* begin       = data;
+    const char* end         = data + len;
+    for (const char* p = data; p < end; ++p) {
+        unsigned char c = *p;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        // 不需要转义的部分整段写入
+        out.append(begin, p - begin);
+        begin = p + 1;
+        switch (c) {
+            case '"':
+                out.append("\\\"", 2);
+                break;
+            case '\\':
+                out.append("\\\\", 2);
+                break;
+            case '\n':
+                out.append("\\n", 2);
+                break;
+            case '\r':
+                out.append("\\r", 2);
+                break;
+            case '\t':
+                out.append("\\t", 2);
+                break;
+            case '\b':
+                out.append("\\b", 2);
+                break;
+            case '\f':
+                out.append("\\f", 2);
+                break;
+            default: {
+                char buf[6] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xf]};
+                out.append(buf, sizeof(buf));
+            }
+        }
     }
+    out.append(begin, end - begin);
 }
 
-std::string StdoutLogAppender::toYamlString() {
-    YAML::Node node;
-    node["type"] = "StdoutLogAppender";
-    if (m_level != LogLevel::UNKNOWN) {
-        node["level"] = LogLevel::ToString(m_level);
+void JsonFormatter::Render(std::string& out, LogLevel::Level level, const LogEvent& event) {
+    out.append("{\"time\":\"");
+    AppendDateTime(out, "%Y-%m-%dT%H:%M:%S.%f", event.getTime(), event.getNsec());
+    out.append("\",\"level\":\"");
+    out.append(LogLevel::ToString(level));
+    out.append("\",\"logger\":\"");
+    const std::string& name = event.getLogger()->getName();
+    AppendEscaped(out, name.data(), name.size());
+    out.append("\",\"thread\":");
+    AppendUInt(out, event.getThreadId());
+    out.append(",\"thread_name\":\"");
+    const char* thread_name = event.getThreadName();
+    AppendEscaped(out, thread_name, strlen(thread_name));
+    out.append("\",\"fiber\":");
+    AppendUInt(out, event.getFiberId());
+    out.append(",\"file\":\"");
+    const char* file = event.getFile() ? event.getFile() : "";
+    AppendEscaped(out, file, strlen(file));
+    out.append("\",\"line\":");
+    AppendInt(out, event.getLine());
+    out.append(",\"message\":\"");
+    const LogStream& ss = event.getSS();
+    AppendEscaped(out, ss.data(), ss.size());
+    if (!event.getArgs().empty()) {
+        // 延迟格式化的参数先渲染到线程内复用的缓冲区
+        static thread_local std::string t_args;
+        t_args.clear();
+        event.getArgs().render(t_args);
+        AppendEscaped(out, t_args.data(), t_args.size());
     }
-    if (m_hasFormatter && m_formatter) {
-        node["formatter"] = m_formatter->getPattern();
+    out.append(1, '"');
+
+    const LogFields& fields = event.getFields();
+    const char* cur         = fields.data();
+    const char* end         = cur + fields.size();
+    std::string_view key;
+    int type;
+    uint64_t num;
+    const char* str = nullptr;
+    uint32_t len    = 0;
+    while (LogFields::Next(cur, end, key, type, num, str, len)) {
+        out.append(",\"", 2);
+        AppendEscaped(out, key.data(), key.size());
+        out.append("\":", 2);
+        if (type == LogFields::STRING) {
+            out.append(1, '"');
+            AppendEscaped(out, str, len);
+            out.append(1, '"');
+        } else if (type == LogFields::INT) {
+            AppendInt(out, static_cast<int64_t>(num));
+        } else if (type == LogFields::UINT) {
+            AppendUInt(out, num);
+        } else if (type == LogFields::BOOL) {
+            out.append(num ? "true" : "false");
+        } else {
+            double v;
+            memcpy(&v, &num, sizeof(v));
+            if (std::isfinite(v)) {
+                char buf[32];
+                out.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr - buf);
+            } else {
+                // JSON不支持NaN、Infinity
+                out.append("null");
+            }
+        }
     }
-    std::stringstream ss;
-    ss << node;
-    return ss.str();
+    out.append("}\n", 2);
 }
 
-LogFormatter::LogFormatter(const std::string& pattern) : m_pattern(pattern), m_error(false) { init(); }
+void LogFormatter::compile(const std::vector<std::tuple<std::string, std::string, int>>& vec) {
+    m_program.clear();
+    m_literals.clear();
+    m_dateFormats.clear();
 
-std::string LogFormatter::format(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) {
-    std::stringstream ss;
-    for (auto& i : m_items) {
-        i->format(ss, logger, level, event);
+    // 追加文本，与前一条文本指令相邻时直接合并
+    auto literal = [this](const std::string& str) {
+        if (!m_program.empty() && m_program.back().code == OP_LITERAL) {
+            m_program.back().len += str.size();
+        } else {
+            Op op = {OP_LITERAL, (uint32_t)m_literals.size(), (uint32_t)str.size()};
+            m_program.push_back(op);
+        }
+        m_literals.append(str);
+    };
+
+    static std::map<std::string, OpCode> s_opcodes = {
+        {"m", OP_MESSAGE},   {"p", OP_LEVEL},    {"r", OP_ELAPSE},   {"c", OP_NAME},
+        {"t", OP_THREAD_ID}, {"F", OP_FIBER_ID}, {"d", OP_DATETIME}, {"f", OP_FILENAME},
+        {"l", OP_LINE},      {"N", OP_THREAD_NAME},
+    };
+
+    for (auto& i : vec) {
+        const std::string& key = std::get<0>(i);
+        if (std::get<2>(i) == 0) {
+            literal(key);
+        } else if (key == "T") {
+            literal("\t");
+        } else if (key == "n") {
+            literal("\n");
+        } else {
+            auto it = s_opcodes.find(key);
+            if (it == s_opcodes.end()) {
+                literal("<<error_format % " + key + " >>");
+                continue;
+            }
+            Op op = {it->second, 0, 0};
+            if (it->second == OP_DATETIME) {
+                // 与DateTimeFormatItem相同的默认日期格式
+                op.offset = m_dateFormats.size();
+                m_dateFormats.push_back(std::get<1>(i).empty() ? "%Y-%m-%d %H:%M:%S" : std::get<1>(i));
+            } else if (it->second == OP_ELAPSE) {
+                op.offset = ElapseDivisor(std::get<1>(i).data(), std::get<1>(i).size());
+            }
+            m_program.push_back(op);
+        }
     }
-    return ss.str();
 }
 
 // 解析 %xx 或 %xx{xx} 同时还需要能够输出 %
@@ -409,7 +3062,8 @@ void LogFormatter::init() {
         // 遍历 % 之后的内容,找到空格结束符，匹配{}
         while (n < m_pattern.size()) {
             // if (isspace(m_pattern[n])) {
-            if (!isalpha(m_pattern[n]) && m_pattern[n] != '{' && m_pattern[n] != '}') {
+            // {}中的内容(例如日期格式中的%、空格)原样保留，直到匹配到}
+            if (format_status == 0 && !isalpha(m_pattern[n]) && m_pattern[n] != '{' && m_pattern[n] != '}') {
                 break;
             }
             if (format_status == 0) {
@@ -427,6 +3081,8 @@ void LogFormatter::init() {
                     // 获取 { } 之间的子串
                     fmt           = m_pattern.substr(format_begin + 1, n - (format_begin + 1));  // 跳过%
                     format_status = 2;
+                    // 跳过}
+                    ++n;
                     break;
                 }
             }
@@ -492,7 +3148,7 @@ void LogFormatter::init() {
         XX("m", MessageFormatItem),  XX("p", LevelFormatItem),    XX("r", ElapseFormatItem),
         XX("c", NameFormatItem),     XX("t", ThreadIdFormatItem), XX("n", NewLineFormatItem),
         XX("d", DateTimeFormatItem), XX("f", FilenameFormatItem), XX("l", LineFormatItem),
-        XX("T", TabFormatItem),      XX("F", FiberIdFormatItem),
+        XX("T", TabFormatItem),      XX("F", FiberIdFormatItem),  XX("N", ThreadNameFormatItem),
 #undef XX
     };
 
@@ -510,46 +3166,155 @@ void LogFormatter::init() {
             }
         }
     }
+    compile(vec);
+}
+
+LoggerRegistry::LoggerRegistry() {
+    Table* table = new Table;
+    table->mask  = 63;
+    table->buckets.reset(new std::atomic<Node*>[table->mask + 1]());
+    m_tables.push_back(table);
+    m_table.store(table, std::memory_order_release);
+}
+
+LoggerRegistry::~LoggerRegistry() {
+    for (auto i : m_nodes) {
+        delete i;
+    }
+    for (auto i : m_tables) {
+        delete i;
+    }
+}
+
+const Logger::ptr* LoggerRegistry::find(std::string_view name) const {
+    size_t hash  = std::hash<std::string_view>()(name);
+    Table* table = m_table.load(std::memory_order_acquire);
+    for (Node* node = table->buckets[hash & table->mask].load(std::memory_order_acquire); node;
+         node       = node->next.load(std::memory_order_acquire)) {
+        if (node->hash == hash && node->name == name) {
+            return &node->logger;
+        }
+    }
+    return nullptr;
+}
+
+LoggerRegistry::Node* LoggerRegistry::link(Table* table, const std::string& name, size_t hash,
+                                           const Logger::ptr& logger) {
+    Node* node   = new Node;
+    node->name   = name;
+    node->hash   = hash;
+    node->logger = logger;
+    std::atomic<Node*>& bucket = table->buckets[hash & table->mask];
+    node->next.store(bucket.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    // 节点内容写完后再发布
+    bucket.store(node, std::memory_order_release);
+    m_nodes.push_back(node);
+    return node;
+}
+
+const Logger::ptr& LoggerRegistry::insert(const Logger::ptr& logger) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (const Logger::ptr* old = find(logger->getName())) {
+        return *old;
+    }
+    size_t hash  = std::hash<std::string_view>()(logger->getName());
+    Table* table = m_table.load(std::memory_order_relaxed);
+    if (m_size + 1 > (table->mask + 1) * 3 / 4) {
+        // 扩容: 在新的桶数组中重新插入所有节点后整体发布，旧的桶数组仍然可以被读取
+        Table* bigger = new Table;
+        bigger->mask  = table->mask * 2 + 1;
+        bigger->buckets.reset(new std::atomic<Node*>[bigger->mask + 1]());
+        for (size_t i = 0; i <= table->mask; ++i) {
+            for (Node* node = table->buckets[i].load(std::memory_order_relaxed); node;
+                 node       = node->next.load(std::memory_order_relaxed)) {
+                link(bigger, node->name, node->hash, node->logger);
+            }
+        }
+        m_tables.push_back(bigger);
+        m_table.store(bigger, std::memory_order_release);
+        table = bigger;
+    }
+    ++m_size;
+    return link(table, logger->getName(), hash, logger)->logger;
+}
+
+std::vector<Logger::ptr> LoggerRegistry::list() const {
+    std::vector<Logger::ptr> loggers;
+    Table* table = m_table.load(std::memory_order_acquire);
+    for (size_t i = 0; i <= table->mask; ++i) {
+        for (Node* node = table->buckets[i].load(std::memory_order_acquire); node;
+             node       = node->next.load(std::memory_order_acquire)) {
+            loggers.push_back(node->logger);
+        }
+    }
+    return loggers;
 }
 
 LoggerManager::LoggerManager() {
     m_root.reset(new Logger);
     m_root->addAppender(LogAppender::ptr(new StdoutLogAppender));
 
-    m_loggers[m_root->m_name] = m_root;
+    m_loggers.insert(m_root);
 
     init();
 }
-Logger::ptr LoggerManager::getLogger(const std::string& name) {
-    auto it = m_loggers.find(name);
-    if (it != m_loggers.end()) {
-        return it->second;
+Logger::ptr LoggerManager::getLogger(std::string_view name) {
+    if (const Logger::ptr* logger = m_loggers.find(name)) {
+        return *logger;
     }
-    Logger::ptr logger(new Logger(name));
-    logger->m_root  = m_root;
-    m_loggers[name] = logger;
-    return logger;
+    Logger::ptr logger(new Logger(std::string(name)));
+    logger->m_root = m_root;
+    // 其他线程可能同时创建了同名的日志器，以先插入的为准
+    return m_loggers.insert(logger);
 }
 
 struct LogAppenderDefine {
-    // 1 File; 2 Stdout
+    // 1 File; 2 Stdout; 3 Async; 4 Ring; 5 Binary; 6 RollingFile; 7 MmapFile
     int type              = 0;
     LogLevel::Level level = LogLevel::UNKNOWN;
     std::string formatter;
     std::string file;
+    // Async/Ring 相关配置, Ring的buffer_size为每个线程的缓冲区大小
+    size_t buffer_size                       = 0;
+    uint32_t flush_interval                  = 0;
+    AsyncLogAppender::FullPolicy full_policy = AsyncLogAppender::BLOCK;
+    bool defer                               = false;
+    bool uring                               = false;
+
+    // RollingFile 相关配置
+    uint64_t max_size                         = 0;
+    RollingFileLogAppender::RollInterval roll = RollingFileLogAppender::DAILY;
+    uint32_t max_files                        = 0;
+    bool compress                             = false;
+
+    // MmapFile 相关配置
+    size_t segment_size                  = 0;
+    MmapFileLogAppender::SyncPolicy sync = MmapFileLogAppender::SYNC_NONE;
+    bool advise                          = true;
+
+    // 刷新策略 flush: {every, interval, level, sync_level}
+    LogFlushPolicy flush;
 
     bool operator==(const LogAppenderDefine& oth) const {
-        return type == oth.type && level == oth.level && formatter == oth.formatter && file == oth.file;
+        return type == oth.type && level == oth.level && formatter == oth.formatter && file == oth.file &&
+               buffer_size == oth.buffer_size && flush_interval == oth.flush_interval &&
+               full_policy == oth.full_policy && defer == oth.defer && uring == oth.uring &&
+               max_size == oth.max_size && roll == oth.roll && max_files == oth.max_files && compress == oth.compress &&
+               segment_size == oth.segment_size && sync == oth.sync && advise == oth.advise && flush == oth.flush;
     }
 };
 struct LogDefine {
     std::string name;
     LogLevel::Level level = LogLevel::UNKNOWN;
     std::string formatter;
+    // 日志器的限流(每秒条数，0表示不限流)
+    double rate_limit   = 0;
+    uint64_t rate_burst = 0;
     std::vector<LogAppenderDefine> appenders;
 
     bool operator==(const LogDefine& oth) const {
-        return name == oth.name && level == oth.level && formatter == oth.formatter && appenders == oth.appenders;
+        return name == oth.name && level == oth.level && formatter == oth.formatter &&
+               rate_limit == oth.rate_limit && rate_burst == oth.rate_burst && appenders == oth.appenders;
     }
 
     bool operator<(const LogDefine& oth) const { return name < oth.name; }
@@ -576,6 +3341,15 @@ class LexicalCast<std::string, std::set<LogDefine>> {
             if (n["formatter"].IsDefined()) {
                 ld.formatter = n["formatter"].as<std::string>();
             }
+            // rate_limit: {rate: 每秒条数, burst: 最多连续条数(默认与rate相同)}
+            if (n["rate_limit"].IsDefined()) {
+                auto r = n["rate_limit"];
+                if (r["rate"].IsDefined()) {
+                    ld.rate_limit = r["rate"].as<double>();
+                }
+                ld.rate_burst = r["burst"].IsDefined() ? r["burst"].as<uint64_t>()
+                                                       : std::max<uint64_t>(1, (uint64_t)ld.rate_limit);
+            }
 
             if (n["appenders"].IsDefined()) {
                 for (size_t x = 0; x < n["appenders"].size(); ++x) {
@@ -598,10 +3372,118 @@ class LexicalCast<std::string, std::set<LogDefine>> {
                         }
                     } else if (type == "StdoutLogAppender") {
                         lad.type = 2;
+                        if (a["formatter"].IsDefined()) {
+                            lad.formatter = a["formatter"].as<std::string>();
+                        }
+                    } else if (type == "AsyncLogAppender") {
+                        lad.type = 3;
+                        if (!a["file"].IsDefined()) {
+                            std::cout << "log config error: asyncappender file is NULL - " << a << "\n";
+                            continue;
+                        }
+                        lad.file = a["file"].as<std::string>();
+                        if (a["buffer_size"].IsDefined()) {
+                            lad.buffer_size = a["buffer_size"].as<size_t>();
+                        }
+                        if (a["flush_interval"].IsDefined()) {
+                            lad.flush_interval = a["flush_interval"].as<uint32_t>();
+                        }
+                        if (a["full_policy"].IsDefined()) {
+                            lad.full_policy = AsyncLogAppender::PolicyFromString(a["full_policy"].as<std::string>());
+                        }
+                        if (a["defer"].IsDefined()) {
+                            lad.defer = a["defer"].as<bool>();
+                        }
+                        // io: write(默认，后台线程直接write) 或 uring(共用的LogIoService批量写入)
+                        if (a["io"].IsDefined()) {
+                            lad.uring = a["io"].as<std::string>() == "uring";
+                        }
+                        if (a["formatter"].IsDefined()) {
+                            lad.formatter = a["formatter"].as<std::string>();
+                        }
+                    } else if (type == "RollingFileLogAppender") {
+                        lad.type = 6;
+                        if (!a["file"].IsDefined()) {
+                            std::cout << "log config error: rollingfileappender file is NULL - " << a << "\n";
+                            continue;
+                        }
+                        lad.file = a["file"].as<std::string>();
+                        if (a["max_size"].IsDefined()) {
+                            lad.max_size = a["max_size"].as<uint64_t>();
+                        }
+                        if (a["roll"].IsDefined()) {
+                            lad.roll = RollingFileLogAppender::IntervalFromString(a["roll"].as<std::string>());
+                        }
+                        if (a["max_files"].IsDefined()) {
+                            lad.max_files = a["max_files"].as<uint32_t>();
+                        }
+                        if (a["compress"].IsDefined()) {
+                            lad.compress = a["compress"].as<bool>();
+                        }
+                        if (a["formatter"].IsDefined()) {
+                            lad.formatter = a["formatter"].as<std::string>();
+                        }
+                    } else if (type == "MmapFileLogAppender") {
+                        lad.type = 7;
+                        if (!a["file"].IsDefined()) {
+                            std::cout << "log config error: mmapfileappender file is NULL - " << a << "\n";
+                            continue;
+                        }
+                        lad.file = a["file"].as<std::string>();
+                        if (a["segment_size"].IsDefined()) {
+                            lad.segment_size = a["segment_size"].as<size_t>();
+                        }
+                        if (a["sync"].IsDefined()) {
+                            lad.sync = MmapFileLogAppender::SyncFromString(a["sync"].as<std::string>());
+                        }
+                        if (a["advise"].IsDefined()) {
+                            lad.advise = a["advise"].as<bool>();
+                        }
+                        if (a["formatter"].IsDefined()) {
+                            lad.formatter = a["formatter"].as<std::string>();
+                        }
+                    } else if (type == "BinaryFileLogAppender") {
+                        lad.type = 5;
+                        if (!a["file"].IsDefined()) {
+                            std::cout << "log config error: binaryfileappender file is NULL - " << a << "\n";
+                            continue;
+                        }
+                        lad.file = a["file"].as<std::string>();
+                    } else if (type == "RingLogAppender") {
+                        lad.type = 4;
+                        // 不指定file时输出到标准输出
+                        if (a["file"].IsDefined()) {
+                            lad.file = a["file"].as<std::string>();
+                        }
+                        if (a["buffer_size"].IsDefined()) {
+                            lad.buffer_size = a["buffer_size"].as<size_t>();
+                        }
+                        if (a["flush_interval"].IsDefined()) {
+                            lad.flush_interval = a["flush_interval"].as<uint32_t>();
+                        }
+                        if (a["formatter"].IsDefined()) {
+                            lad.formatter = a["formatter"].as<std::string>();
+                        }
                     } else {
                         std::cout << "log config error: name is NULL - " << a << "\n";
                         continue;
                     }
+                    // flush: {every: 条数, interval: 毫秒, level: 立即刷新的级别, sync_level: fdatasync的级别}
+                    if (a["flush"].IsDefined()) {
+                        auto f = a["flush"];
+                        if (f["every"].IsDefined()) {
+                            lad.flush.every = f["every"].as<uint32_t>();
+                        }
+                        if (f["interval"].IsDefined()) {
+                            lad.flush.interval = f["interval"].as<uint32_t>();
+                        }
+                        if (f["level"].IsDefined()) {
+                            lad.flush.level = LogLevel::FromString(f["level"].as<std::string>());
+                        }
+                        if (f["sync_level"].IsDefined()) {
+                            lad.flush.sync_level = LogLevel::FromString(f["sync_level"].as<std::string>());
+                        }
+                    }
                     ld.appenders.push_back(lad);
                 }
             }
@@ -625,6 +3507,10 @@ class LexicalCast<std::set<LogDefine>, std::string> {
             if (i.formatter.empty()) {
                 n["formatter"] = i.formatter;
             }
+            if (i.rate_limit > 0) {
+                n["rate_limit"]["rate"]  = i.rate_limit;
+                n["rate_limit"]["burst"] = i.rate_burst;
+            }
 
             for (auto& a : i.appenders) {
                 YAML::Node na;
@@ -633,10 +3519,73 @@ class LexicalCast<std::set<LogDefine>, std::string> {
                     na["file"] = a.file;
                 } else if (a.type == 2) {
                     na["type"] = "StdoutLogAppender";
+                } else if (a.type == 3) {
+                    na["type"] = "AsyncLogAppender";
+                    na["file"] = a.file;
+                    if (a.buffer_size) {
+                        na["buffer_size"] = a.buffer_size;
+                    }
+                    if (a.flush_interval) {
+                        na["flush_interval"] = a.flush_interval;
+                    }
+                    na["full_policy"] = AsyncLogAppender::PolicyToString(a.full_policy);
+                    if (a.defer) {
+                        na["defer"] = true;
+                    }
+                    if (a.uring) {
+                        na["io"] = "uring";
+                    }
+                } else if (a.type == 6) {
+                    na["type"] = "RollingFileLogAppender";
+                    na["file"] = a.file;
+                    if (a.max_size) {
+                        na["max_size"] = a.max_size;
+                    }
+                    na["roll"] = RollingFileLogAppender::IntervalToString(a.roll);
+                    if (a.max_files) {
+                        na["max_files"] = a.max_files;
+                    }
+                    if (a.compress) {
+                        na["compress"] = true;
+                    }
+                } else if (a.type == 7) {
+                    na["type"] = "MmapFileLogAppender";
+                    na["file"] = a.file;
+                    if (a.segment_size) {
+                        na["segment_size"] = a.segment_size;
+                    }
+                    na["sync"]   = MmapFileLogAppender::SyncToString(a.sync);
+                    na["advise"] = a.advise;
+                } else if (a.type == 5) {
+                    na["type"] = "BinaryFileLogAppender";
+                    na["file"] = a.file;
+                } else if (a.type == 4) {
+                    na["type"] = "RingLogAppender";
+                    if (!a.file.empty()) {
+                        na["file"] = a.file;
+                    }
+                    if (a.buffer_size) {
+                        na["buffer_size"] = a.buffer_size;
+                    }
+                    if (a.flush_interval) {
+                        na["flush_interval"] = a.flush_interval;
+                    }
                 }
                 if (a.level != LogLevel::UNKNOWN) {
                     na["level"] = LogLevel::ToString(a.level);
                 }
+                if (a.flush.every) {
+                    na["flush"]["every"] = a.flush.every;
+                }
+                if (a.flush.interval) {
+                    na["flush"]["interval"] = a.flush.interval;
+                }
+                if (a.flush.level != LogLevel::UNKNOWN) {
+                    na["flush"]["level"] = LogLevel::ToString(a.flush.level);
+                }
+                if (a.flush.sync_level != LogLevel::UNKNOWN) {
+                    na["flush"]["sync_level"] = LogLevel::ToString(a.flush.sync_level);
+                }
                 if (!a.formatter.empty()) {
                     na["formatter"] = a.formatter;
                 }
@@ -653,6 +3602,10 @@ class LexicalCast<std::set<LogDefine>, std::string> {
 mylog::ConfigVar<std::set<LogDefine>>::ptr g_log_defines =
     mylog::Config::Lookup("logs", std::set<LogDefine>(), "logs config");
 
+// 日志时间戳的时钟源: realtime(默认)、coarse、tsc
+mylog::ConfigVar<std::string>::ptr g_log_clock =
+    mylog::Config::Lookup("log_clock", std::string("realtime"), "log timestamp clock source");
+
 struct LogIniter {
     LogIniter() {
         g_log_defines->addListener(
@@ -670,28 +3623,50 @@ struct LogIniter {
                         logger = MYLOG_LOG_NAME(i.name);
 
                     } else {
-                        // 是否更新(发生变化)
-                        if (!(i == *it)) {
-                            // 修改旧的logger
-                            logger = MYLOG_LOG_NAME(i.name);
+                        // 没有变化的logger保留原来的Appender(不重启Async/Ring的后台线程)
+                        if (i == *it) {
+                            continue;
                         }
+                        // 修改旧的logger
+                        logger = MYLOG_LOG_NAME(i.name);
                     }
                     logger->setLevel(i.level);
                     if (!i.formatter.empty()) {
                         logger->setFormatter((i.formatter));
                     }
+                    logger->setRateLimit(i.rate_limit, i.rate_burst);
 
-                    logger->clearAppenders();
+                    // 新的Appender集合创建完成后一次替换，输出日志的线程不会看到中间状态
+                    std::vector<LogAppender::ptr> appenders;
                     for (auto& a : i.appenders) {
                         mylog::LogAppender::ptr ap;
                         if (a.type == 1) {
                             ap.reset(new FileLogAppender(a.file));
                         } else if (a.type == 2) {
                             ap.reset(new StdoutLogAppender);
+                        } else if (a.type == 3) {
+                            ap.reset(new AsyncLogAppender(a.file, a.buffer_size, a.flush_interval, a.full_policy,
+                                                          a.defer, a.uring));
+                        } else if (a.type == 4) {
+                            ap.reset(new RingLogAppender(a.file, a.buffer_size, a.flush_interval));
+                        } else if (a.type == 5) {
+                            ap.reset(new BinaryFileLogAppender(a.file));
+                        } else if (a.type == 6) {
+                            ap.reset(new RollingFileLogAppender(a.file, a.max_size, a.roll, a.max_files, a.compress));
+                        } else if (a.type == 7) {
+                            if (a.segment_size) {
+                                ap.reset(new MmapFileLogAppender(a.file, a.segment_size, a.sync, a.advise));
+                            } else {
+                                ap.reset(new MmapFileLogAppender(a.file, 32 * 1024 * 1024, a.sync, a.advise));
+                            }
                         }
                         ap->setLevel(a.level);
+                        // 没有配置时保留各Appender默认的策略
+                        if (!(a.flush == LogFlushPolicy())) {
+                            ap->setFlushPolicy(a.flush);
+                        }
                         if (!a.formatter.empty()) {
-                            LogFormatter::ptr fmt(new LogFormatter(a.formatter));
+                            LogFormatter::ptr fmt = LogFormatter::Create(a.formatter);
                             if (!fmt->isError()) {
                                 ap->setFormatter(fmt);
                             } else {
@@ -701,8 +3676,9 @@ struct LogIniter {
                             }
                         }
 
-                        logger->addAppender(ap);
+                        appenders.push_back(ap);
                     }
+                    logger->setAppenders(appenders);
                 }
 
                 // 删除
@@ -713,16 +3689,36 @@ struct LogIniter {
                         auto logger = MYLOG_LOG_NAME(i.name);
                         // 这里使用高等级(不会用到的等级)来表示删除
                         logger->setLevel((LogLevel::Level)100);
+                        logger->setRateLimit(0, 0);
                         // 清空，相当于删除，下次默认使用root打印
                         logger->clearAppenders();
                     }
                 }
             });
+        g_log_clock->addListener(0xF1E232, [](const std::string& old_value, const std::string& new_value) {
+            ClockSource source = CLOCK_SOURCE_REALTIME;
+            if (new_value == "coarse") {
+                source = CLOCK_SOURCE_COARSE;
+            } else if (new_value == "tsc") {
+                source = CLOCK_SOURCE_TSC;
+            } else if (new_value != "realtime") {
+                std::cout << "log_clock = " << new_value << " is invalid, use realtime" << "\n";
+            }
+            if (!SetClockSource(source)) {
+                std::cout << "log_clock = " << new_value << " is not supported, use realtime" << "\n";
+                SetClockSource(CLOCK_SOURCE_REALTIME);
+            }
+        });
     }
 };
 std::string LoggerManager::toYamlString() {
+    // 按照名称排序输出
+    std::map<std::string, Logger::ptr> loggers;
+    for (auto& i : m_loggers.list()) {
+        loggers[i->getName()] = i;
+    }
     YAML::Node node;
-    for (auto& i : m_loggers) {
+    for (auto& i : loggers) {
         node.push_back(YAML::Load(i.second->toYamlString()));
     }
     std::stringstream ss;
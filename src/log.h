@@ -2,24 +2,45 @@
 #define __MYLOG_LOG_H_
 
 #include <stdint.h>
+#include <string.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <fstream>
 #include <iostream>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
+#include "rcu.h"
 #include "singleton.h"
 #include "util.h"
 
+// 编译期的最低日志级别(数值与mylog::LogLevel::Level相同)，低于该级别的日志语句在编译时删除
+// 例如发布版本使用 -DMYLOG_MIN_LEVEL=2 去掉所有DEBUG日志
+#ifndef MYLOG_MIN_LEVEL
+#define MYLOG_MIN_LEVEL 1
+#endif
+
+// level级别的日志是否需要输出，level为常量时编译期级别的判断在编译时完成，
+// 运行期只有一次原子读取和一个预测为不输出的分支
+#define MYLOG_LOG_ENABLED(logger, level) \
+    ((level) >= MYLOG_MIN_LEVEL && MYLOG_UNLIKELY((logger)->isEnabled(level)))
+
 // 写入level级别的流式日志
 #define MYLOG_LOG_LEVEL(logger, level)                                                                                 \
-    if (logger->getLevel() <= level)                                                                                   \
-    mylog::LogEventWrap(mylog::LogEvent::ptr(new mylog::LogEvent(logger, level, __FILE__, __LINE__, 0,                 \
-                                                                 mylog::GetThreadId(), mylog::GetFiberId(), time(0)))) \
+    if (MYLOG_LOG_ENABLED(logger, level))                                                                              \
+    mylog::LogEventWrap(mylog::LogEvent::Create(logger, level, __FILE__, __LINE__, mylog::GetThreadId(),               \
+                                                mylog::GetFiberId(), mylog::GetRealTime()))                            \
         .getSS()
 
 // 使用logger写入debug级别的流式日志
@@ -34,12 +55,14 @@
 #define MYLOG_LOG_FATAL(logger) MYLOG_LOG_LEVEL(logger, mylog::LogLevel::FATAL)
 
 // 使用logger写入level级别的日志 (格式化, printf)
+// 字符串字面量的格式串只保存指针，格式化可能推迟到调用返回之后(defer模式的后台线程)；
+// 其他格式串(局部缓冲区、c_str()等)在调用处立即格式化
 #define MYLOG_LOG_FMT_LEVEL(logger, level, fmt, ...)                                                                   \
-    if (logger->getLevel() <= level)                                                                                   \
-    mylog::LogEventWrap(mylog::LogEvent::ptr(new mylog::LogEvent(logger, level, __FILE__, __LINE__, 0,                 \
-                                                                 mylog::GetThreadId(), mylog::GetFiberId(), time(0)))) \
+    if (MYLOG_LOG_ENABLED(logger, level))                                                                              \
+    mylog::LogEventWrap(mylog::LogEvent::Create(logger, level, __FILE__, __LINE__, mylog::GetThreadId(),               \
+                                                mylog::GetFiberId(), mylog::GetRealTime()))                            \
         .getEvent()                                                                                                    \
-        ->format(fmt, __VA_ARGS__)
+        ->formatPrintf(__builtin_constant_p(fmt), fmt, __VA_ARGS__)
 
 // 使用logger写入debug级别的日志 (格式化, printf)
 #define MYLOG_LOG_FMT_DEBUG(logger, fmt, ...) MYLOG_LOG_FMT_LEVEL(logger, mylog::LogLevel::DEBUG, fmt, __VA_ARGS__)
@@ -51,10 +74,67 @@
 #define MYLOG_LOG_FMT_ERROR(logger, fmt, ...) MYLOG_LOG_FMT_LEVEL(logger, mylog::LogLevel::ERROR, fmt, __VA_ARGS__)
 // 使用logger写入fatal级别的日志 (格式化, printf)
 #define MYLOG_LOG_FMT_FATAL(logger, fmt, ...) MYLOG_LOG_FMT_LEVEL(logger, mylog::LogLevel::FATAL, fmt, __VA_ARGS__)
+// 使用logger写入level级别的日志 ({}占位符，格式串必须是字符串字面量)
+// 占位符数量、格式与参数类型在编译期检查，直接格式化到日志事件的缓冲区
+// {} 默认格式; {:x} {:X} 十六进制整数; {:.3f} {:e} {:g} {:.6} 浮点数; {{ }} 输出花括号
+#define MYLOG_LOG_FORMAT_LEVEL(logger, level, fmt, ...)                                                                \
+    if (MYLOG_LOG_ENABLED(logger, level))                                                                              \
+    mylog::LogEventWrap(mylog::LogEvent::Create(logger, level, __FILE__, __LINE__, mylog::GetThreadId(),               \
+                                                mylog::GetFiberId(), mylog::GetRealTime()))                            \
+        .getSS()                                                                                                       \
+        .print([]() constexpr { return fmt; }, ##__VA_ARGS__)
+
+// 使用logger写入debug级别的日志 ({}占位符)
+#define MYLOG_LOG_FORMAT_DEBUG(logger, fmt, ...) MYLOG_LOG_FORMAT_LEVEL(logger, mylog::LogLevel::DEBUG, fmt, ##__VA_ARGS__)
+// 使用logger写入info级别的日志 ({}占位符)
+#define MYLOG_LOG_FORMAT_INFO(logger, fmt, ...) MYLOG_LOG_FORMAT_LEVEL(logger, mylog::LogLevel::INFO, fmt, ##__VA_ARGS__)
+// 使用logger写入warn级别的日志 ({}占位符)
+#define MYLOG_LOG_FORMAT_WARN(logger, fmt, ...) MYLOG_LOG_FORMAT_LEVEL(logger, mylog::LogLevel::WARN, fmt, ##__VA_ARGS__)
+// 使用logger写入error级别的日志 ({}占位符)
+#define MYLOG_LOG_FORMAT_ERROR(logger, fmt, ...) MYLOG_LOG_FORMAT_LEVEL(logger, mylog::LogLevel::ERROR, fmt, ##__VA_ARGS__)
+// 使用logger写入fatal级别的日志 ({}占位符)
+#define MYLOG_LOG_FORMAT_FATAL(logger, fmt, ...) MYLOG_LOG_FORMAT_LEVEL(logger, mylog::LogLevel::FATAL, fmt, ##__VA_ARGS__)
+
+// 每个调用处独立的限流状态(常量初始化，没有初始化检查)
+#define MYLOG_LOG_SITE_LIMITER()                     \
+    ([]() -> mylog::LogLimiter* {                    \
+        static mylog::LogLimiter s_mylog_limiter;    \
+        return &s_mylog_limiter;                     \
+    }())
+
+// 使用调用处的限流状态写入level级别的流式日志，check为LogLimiter的判断方法
+// 输出的日志前会带上此前被抑制的次数，例如 "[suppressed 100] "
+#define MYLOG_LOG_LIMITED(logger, level, check)                                                                        \
+    if (mylog::LogLimiter* mylog_limiter = MYLOG_LOG_SITE_LIMITER();                                                   \
+        MYLOG_LOG_ENABLED(logger, level) && mylog_limiter->check)                                                      \
+    mylog_limiter->prefix(mylog::LogEventWrap(mylog::LogEvent::Create(logger, level, __FILE__, __LINE__,               \
+                                                                      mylog::GetThreadId(), mylog::GetFiberId(),       \
+                                                                      mylog::GetRealTime()))                           \
+                              .getSS())
+
+// 每n次输出一次(第1、n+1、2n+1...次)
+#define MYLOG_LOG_EVERY_N(logger, level, n) MYLOG_LOG_LIMITED(logger, level, everyN(n))
+// 只输出前n次
+#define MYLOG_LOG_FIRST_N(logger, level, n) MYLOG_LOG_LIMITED(logger, level, firstN(n))
+// 每ms毫秒最多输出一次
+#define MYLOG_LOG_EVERY_MS(logger, level, ms) MYLOG_LOG_LIMITED(logger, level, everyMs(ms))
+// 令牌桶: 平均每秒最多rate次，最多连续输出burst次
+#define MYLOG_LOG_RATE(logger, level, rate, burst) MYLOG_LOG_LIMITED(logger, level, tokenBucket(rate, burst))
+
 // 获取日志类
 #define MYLOG_LOG_ROOT() mylog::LoggerMgr::GetInstance()->getRoot()
 // 对应的log
 #define MYLOG_LOG_NAME(name) mylog::LoggerMgr::GetInstance()->getLogger(name)
+// 对应的log，每个调用处只查找一次(name在调用处必须不变，例如字符串字面量)
+#define MYLOG_LOG_NAME_CACHED(name)                                                              \
+    ([]() -> const mylog::Logger::ptr& {                                                         \
+        static const mylog::Logger::ptr s_mylog_cached_logger = MYLOG_LOG_NAME(name);          \
+        return s_mylog_cached_logger;                                                            \
+    }())
+
+namespace YAML {
+class Node;
+}
 
 namespace mylog {
 
@@ -71,27 +151,562 @@ class LogLevel {
     static LogLevel::Level FromString(const std::string& str);
 };
 
+// 延迟格式化的日志参数
+// 调用处只记录printf格式串的指针和原始参数(整数、浮点数、字符串内容)，
+// 真正的格式化推迟到输出日志时(后台线程或离线解码)才进行
+class LogArgs {
+   public:
+    // 参数的类型标记，每个参数编码为 [类型(1字节)][8字节数值] 或 [STRING][4字节长度][内容]
+    enum Type { INT = 1, UINT = 2, DOUBLE = 3, STRING = 4, POINTER = 5 };
+    // 小于该长度的参数记录不需要申请堆内存
+    static const size_t kInlineSize = 128;
+
+    LogArgs() {}
+    LogArgs(const LogArgs&) = delete;
+    LogArgs& operator=(const LogArgs&) = delete;
+
+    // 记录格式串与参数，只保存fmt的指针(字符串内容在格式化时才读取)
+    template <class... Args>
+    void capture(const char* fmt, const Args&... args) {
+        clear();
+        m_fmt       = fmt;
+        int dummy[] = {0, (add(args), 0)...};
+        (void)dummy;
+    }
+    // 直接设置已经编码好的参数(用于离线解码)
+    void assign(const char* fmt, const char* data, size_t len);
+    void clear();
+    // 是否记录过格式串
+    bool empty() const { return m_fmt == nullptr; }
+    const char* getFormat() const { return m_fmt; }
+    // 编码后的参数
+    const char* data() const { return m_onHeap ? m_heap.data() : m_inline; }
+    size_t size() const { return m_size; }
+    // 按照printf的语义将格式化结果追加到out
+    void render(std::string& out) const;
+    // 从编码后的参数中读取一个参数，没有参数时返回false
+    // 字符串参数返回str/len，其余类型的值以原始的8字节返回到num
+    static bool Next(const char*& cur, const char* end, int& type, uint64_t& num, const char*& str, uint32_t& len);
+
+   private:
+    template <class T>
+    typename std::enable_if<(std::is_integral<T>::value || std::is_enum<T>::value) && std::is_signed<T>::value>::type
+    add(T v) {
+        addNumber(INT, static_cast<int64_t>(v));
+    }
+    template <class T>
+    typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type add(T v) {
+        addNumber(UINT, static_cast<uint64_t>(v));
+    }
+    // 枚举按照整数处理
+    template <class T>
+    typename std::enable_if<std::is_enum<T>::value>::type add(T v) {
+        addNumber(INT, static_cast<int64_t>(v));
+    }
+    template <class T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type add(T v) {
+        addNumber(DOUBLE, static_cast<double>(v));
+    }
+    template <class T>
+    void add(T* v) {
+        addPointer(v);
+    }
+    void add(const std::string& v) { addString(v.data(), v.size()); }
+    void add(std::nullptr_t) { addPointer(static_cast<const void*>(nullptr)); }
+
+    void addPointer(const char* v);
+    void addPointer(const volatile void* v) { addNumber(POINTER, reinterpret_cast<uint64_t>(v)); }
+    template <class T>
+    void addNumber(Type type, T v) {
+        char buf[1 + sizeof(T)];
+        buf[0] = static_cast<char>(type);
+        memcpy(buf + 1, &v, sizeof(T));
+        append(buf, sizeof(buf));
+    }
+    void addString(const char* v, size_t len);
+    void append(const char* v, size_t len);
+
+   private:
+    const char* m_fmt = nullptr;
+    size_t m_size     = 0;
+    bool m_onHeap     = false;
+    char m_inline[kInlineSize];
+    // 超出内联空间时使用
+    std::string m_heap;
+};
+
+// {}占位符格式串的解析与编译期检查(MYLOG_LOG_FORMAT_*)
+class LogFormatString {
+   public:
+    // 参数的类别，决定可以使用的格式
+    enum Kind { KIND_OTHER = 0, KIND_INT, KIND_FLOAT, KIND_STRING, KIND_POINTER, KIND_BOOL, KIND_CHAR };
+    enum Error { OK = 0, ERROR_BRACE, ERROR_SPEC, ERROR_TOO_FEW_ARGS, ERROR_TOO_MANY_ARGS, ERROR_TYPE };
+    // 占位符中的格式
+    struct Spec {
+        // 0(默认)、x、X、f、e、g
+        char type = 0;
+        // -1表示没有指定
+        int precision = -1;
+    };
+
+    template <class T>
+    static constexpr Kind KindOf() {
+        typedef typename std::decay<T>::type U;
+        if constexpr (std::is_same<U, bool>::value) {
+            return KIND_BOOL;
+        } else if constexpr (std::is_same<U, char>::value) {
+            return KIND_CHAR;
+        } else if constexpr (std::is_integral<U>::value || std::is_enum<U>::value) {
+            return KIND_INT;
+        } else if constexpr (std::is_floating_point<U>::value) {
+            return KIND_FLOAT;
+        } else if constexpr (std::is_same<U, char*>::value || std::is_same<U, const char*>::value ||
+                             std::is_same<U, std::string>::value || std::is_same<U, std::string_view>::value) {
+            return KIND_STRING;
+        } else if constexpr (std::is_pointer<U>::value || std::is_null_pointer<U>::value) {
+            return KIND_POINTER;
+        } else {
+            return KIND_OTHER;
+        }
+    }
+
+    // 解析占位符，p指向'{'，返回'}'之后的位置，格式错误时返回nullptr
+    static constexpr const char* ParseSpec(const char* p, Spec& spec) {
+        ++p;
+        if (*p == ':') {
+            ++p;
+            if (*p == '.') {
+                ++p;
+                if (*p < '0' || *p > '9') {
+                    return nullptr;
+                }
+                spec.precision = 0;
+                while (*p >= '0' && *p <= '9') {
+                    spec.precision = spec.precision * 10 + (*p++ - '0');
+                }
+            }
+            if (*p == 'x' || *p == 'X' || *p == 'f' || *p == 'e' || *p == 'g') {
+                if (spec.precision >= 0 && (*p == 'x' || *p == 'X')) {
+                    return nullptr;
+                }
+                spec.type = *p++;
+            }
+        }
+        return *p == '}' ? p + 1 : nullptr;
+    }
+
+    // 跳过普通文本({{、}}为转义)，返回下一个占位符的位置或者结尾，单独的'}'返回nullptr
+    static constexpr const char* NextPlaceholder(const char* p) {
+        while (*p) {
+            if (*p == '{') {
+                if (p[1] != '{') {
+                    return p;
+                }
+                p += 2;
+            } else if (*p == '}') {
+                if (p[1] != '}') {
+                    return nullptr;
+                }
+                p += 2;
+            } else {
+                ++p;
+            }
+        }
+        return p;
+    }
+
+    // 检查格式串与n个参数的类别
+    static constexpr Error Check(const char* fmt, const Kind* kinds, size_t n) {
+        size_t index  = 0;
+        const char* p = fmt;
+        while (true) {
+            p = NextPlaceholder(p);
+            if (!p) {
+                return ERROR_BRACE;
+            }
+            if (!*p) {
+                break;
+            }
+            Spec spec;
+            p = ParseSpec(p, spec);
+            if (!p) {
+                return ERROR_SPEC;
+            }
+            if (index >= n) {
+                return ERROR_TOO_FEW_ARGS;
+            }
+            Kind kind = kinds[index++];
+            if (spec.type == 'x' || spec.type == 'X') {
+                if (kind != KIND_INT && kind != KIND_POINTER) {
+                    return ERROR_TYPE;
+                }
+            } else if (spec.type || spec.precision >= 0) {
+                if (kind != KIND_FLOAT) {
+                    return ERROR_TYPE;
+                }
+            }
+        }
+        return index == n ? OK : ERROR_TOO_MANY_ARGS;
+    }
+};
+
+// 结构化日志的字段(key=value)，值保留原始类型，输出时才转换(文本或JSON)
+// 每个字段编码为 [key长度(1字节)][key][类型(1字节)][8字节数值] 或 [STRING][4字节长度][内容]
+class LogFields {
+   public:
+    enum Type { INT = 1, UINT = 2, DOUBLE = 3, STRING = 4, BOOL = 5 };
+    // 小于该长度的字段不需要申请堆内存
+    static const size_t kInlineSize = 128;
+
+    LogFields() {}
+    LogFields(const LogFields&) = delete;
+    LogFields& operator=(const LogFields&) = delete;
+
+    // 添加字段，key超过255个字符时截断
+    template <class T>
+    void add(std::string_view key, const T& v) {
+        if constexpr (std::is_same<T, bool>::value) {
+            addNumber(key, BOOL, static_cast<uint64_t>(v));
+        } else if constexpr (std::is_enum<T>::value) {
+            addNumber(key, INT, static_cast<int64_t>(v));
+        } else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+            addNumber(key, INT, static_cast<int64_t>(v));
+        } else if constexpr (std::is_integral<T>::value) {
+            addNumber(key, UINT, static_cast<uint64_t>(v));
+        } else if constexpr (std::is_floating_point<T>::value) {
+            addNumber(key, DOUBLE, static_cast<double>(v));
+        } else {
+            // 字符串(const char*、std::string、std::string_view)
+            addString(key, std::string_view(v));
+        }
+    }
+    void clear();
+    bool empty() const { return m_size == 0; }
+    const char* data() const { return m_onHeap ? m_heap.data() : m_inline; }
+    size_t size() const { return m_size; }
+    // 以 " key=value" 的形式追加到out(文本格式)
+    void render(std::string& out) const;
+    // 读取一个字段，没有字段时返回false
+    // 字符串返回str/len，其余类型的值以原始的8字节返回到num
+    static bool Next(const char*& cur, const char* end, std::string_view& key, int& type, uint64_t& num,
+                     const char*& str, uint32_t& len);
+
+   private:
+    template <class T>
+    void addNumber(std::string_view key, Type type, T v) {
+        addKey(key, type);
+        append(reinterpret_cast<const char*>(&v), sizeof(v));
+    }
+    void addString(std::string_view key, std::string_view v);
+    void addKey(std::string_view key, Type type);
+    void append(const char* v, size_t len);
+
+   private:
+    size_t m_size = 0;
+    bool m_onHeap = false;
+    char m_inline[kInlineSize];
+    // 超出内联空间时使用
+    std::string m_heap;
+};
+
+// 日志内容的缓冲区，较短的内容直接写入内联空间，超出时转移到堆上
+// 日志事件被对象池复用时，堆上的空间也一并保留
+class LogStreamBuf : public std::streambuf {
+   public:
+    static const size_t kInlineSize = 256;
+    // 复用时保留的堆空间上限
+    static const size_t kMaxKeepSize = 64 * 1024;
+
+    LogStreamBuf() { setp(m_inline, m_inline + kInlineSize); }
+    LogStreamBuf(const LogStreamBuf&) = delete;
+    LogStreamBuf& operator=(const LogStreamBuf&) = delete;
+
+    const char* data() const { return pbase(); }
+    size_t size() const { return pptr() - pbase(); }
+    void clear();
+    // 返回至少可以写入n个字节的位置，写入后调用commit
+    char* reserve(size_t n) {
+        if (static_cast<size_t>(epptr() - pptr()) < n) {
+            grow(n);
+        }
+        return pptr();
+    }
+    void commit(size_t n) { pbump(n); }
+
+   protected:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+    // 只支持tellp
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+
+   private:
+    // 保证至少还能写入n个字节
+    void grow(size_t n);
+
+   private:
+    char m_inline[kInlineSize];
+    std::string m_heap;
+};
+
+// 日志内容的输出流，保留std::ostream的 << 写法
+// 整数、浮点数、字符串直接转换后写入缓冲区，不经过std::ostream和locale；
+// 其他类型(自定义了operator<<的类型)以及设置过格式(std::hex、std::setw等)之后的输出交给std::ostream，
+// 输出结果与std::ostream一致
+class LogStream {
+   public:
+    typedef LogStream self;
+    LogStream() {}
+    LogStream(const LogStream&) = delete;
+    LogStream& operator=(const LogStream&) = delete;
+
+    self& operator<<(bool v) { return m_formatted ? stream(v) : write(v ? "1" : "0", 1); }
+    self& operator<<(char v) { return m_formatted ? stream(v) : write(&v, 1); }
+    self& operator<<(signed char v) { return *this << static_cast<char>(v); }
+    self& operator<<(unsigned char v) { return *this << static_cast<char>(v); }
+    self& operator<<(short v) { return number(v); }
+    self& operator<<(unsigned short v) { return number(v); }
+    self& operator<<(int v) { return number(v); }
+    self& operator<<(unsigned int v) { return number(v); }
+    self& operator<<(long v) { return number(v); }
+    self& operator<<(unsigned long v) { return number(v); }
+    self& operator<<(long long v) { return number(v); }
+    self& operator<<(unsigned long long v) { return number(v); }
+    self& operator<<(float v) { return number(static_cast<double>(v)); }
+    self& operator<<(double v) { return number(v); }
+    self& operator<<(long double v) { return number(v); }
+    self& operator<<(const void* v);
+    self& operator<<(const char* v) {
+        if (m_formatted) {
+            return stream(v);
+        }
+        return v ? write(v, strlen(v)) : *this;
+    }
+    self& operator<<(char* v) { return *this << static_cast<const char*>(v); }
+    self& operator<<(const std::string& v) { return m_formatted ? stream(v) : write(v.data(), v.size()); }
+    self& operator<<(std::string_view v) { return m_formatted ? stream(v) : write(v.data(), v.size()); }
+    // 结构化字段，例如 MYLOG_LOG_INFO(logger).kv("user", id).kv("latency_us", t) << "message"
+    // 属于日志事件时记录到事件的字段中，否则以 " key=value" 写入内容
+    template <class T>
+    self& kv(std::string_view key, const T& v) {
+        if (m_fields) {
+            m_fields->add(key, v);
+            return *this;
+        }
+        write(" ", 1).write(key.data(), key.size()).write("=", 1);
+        return *this << v;
+    }
+    void setFields(LogFields* fields) { m_fields = fields; }
+    // 按照{}占位符格式串写入，fmt为返回字符串字面量的constexpr函数(见MYLOG_LOG_FORMAT_LEVEL)
+    template <class F, class... Args>
+    self& print(F fmt, const Args&... args) {
+        constexpr LogFormatString::Kind kinds[] = {LogFormatString::KIND_OTHER, LogFormatString::KindOf<Args>()...};
+        constexpr LogFormatString::Error error  = LogFormatString::Check(fmt(), kinds + 1, sizeof...(Args));
+        static_assert(error != LogFormatString::ERROR_BRACE, "mylog format: unmatched '{' or '}'");
+        static_assert(error != LogFormatString::ERROR_SPEC, "mylog format: invalid format spec");
+        static_assert(error != LogFormatString::ERROR_TOO_FEW_ARGS, "mylog format: too few arguments");
+        static_assert(error != LogFormatString::ERROR_TOO_MANY_ARGS, "mylog format: too many arguments");
+        static_assert(error != LogFormatString::ERROR_TYPE, "mylog format: format spec does not match argument type");
+        const char* p = fmt();
+        (printArg(p, args), ...);
+        printLiteral(p, nullptr);
+        return *this;
+    }
+    // 返回至少可以写入n个字节的位置，写入后调用commit
+    char* reserve(size_t n) { return m_buf.reserve(n); }
+    void commit(size_t n) { m_buf.commit(n); }
+    // std::endl、std::hex等操纵符
+    self& operator<<(std::ostream& (*manip)(std::ostream&)) {
+        manip(getStream());
+        return updateFormatted();
+    }
+    self& operator<<(std::ios_base& (*manip)(std::ios_base&)) {
+        manip(getStream());
+        return updateFormatted();
+    }
+    // 其他类型使用std::ostream的operator<<
+    template <class T>
+    self& operator<<(const T& v) {
+        return stream(v);
+    }
+
+    self& write(const char* data, size_t len) {
+        memcpy(m_buf.reserve(len), data, len);
+        m_buf.commit(len);
+        return *this;
+    }
+    const char* data() const { return m_buf.data(); }
+    size_t size() const { return m_buf.size(); }
+    std::string str() const { return std::string(data(), size()); }
+    // 清空内容并恢复默认格式
+    void clear();
+
+   private:
+    template <class T>
+    self& number(T v) {
+        if (m_formatted) {
+            return stream(v);
+        }
+        char* p = m_buf.reserve(kNumberSize);
+        m_buf.commit(ToChars(p, p + kNumberSize, v) - p);
+        return *this;
+    }
+    template <class T>
+    self& stream(const T& v) {
+        getStream() << v;
+        return updateFormatted();
+    }
+    std::ostream& getStream() {
+        if (!m_stream) {
+            m_stream.emplace(&m_buf);
+        }
+        return *m_stream;
+    }
+    // std::ostream的格式不是默认值时，之后的输出都交给std::ostream
+    self& updateFormatted();
+
+    // 写入普通文本直到下一个占位符，解析占位符的格式(格式串已经在编译期检查过)
+    void printLiteral(const char*& p, LogFormatString::Spec* spec);
+    template <class T>
+    void printArg(const char*& p, const T& v) {
+        LogFormatString::Spec spec;
+        printLiteral(p, &spec);
+        constexpr LogFormatString::Kind kind = LogFormatString::KindOf<T>();
+        if constexpr (kind == LogFormatString::KIND_INT) {
+            if constexpr (std::is_signed<T>::value) {
+                printInt(static_cast<long long>(v) < 0, static_cast<unsigned long long>(v), spec);
+            } else {
+                printInt(false, static_cast<unsigned long long>(v), spec);
+            }
+        } else if constexpr (kind == LogFormatString::KIND_FLOAT) {
+            printDouble(static_cast<double>(v), spec);
+        } else if constexpr (kind == LogFormatString::KIND_STRING) {
+            std::string_view str(v);
+            write(str.data(), str.size());
+        } else if constexpr (kind == LogFormatString::KIND_POINTER) {
+            printPointer(reinterpret_cast<uintptr_t>(static_cast<const volatile void*>(v)), spec);
+        } else if constexpr (kind == LogFormatString::KIND_BOOL) {
+            v ? write("true", 4) : write("false", 5);
+        } else if constexpr (kind == LogFormatString::KIND_CHAR) {
+            write(&v, 1);
+        } else {
+            *this << v;
+        }
+    }
+    // negative为true时v为负数的补码
+    void printInt(bool negative, unsigned long long v, const LogFormatString::Spec& spec);
+    void printDouble(double v, const LogFormatString::Spec& spec);
+    void printPointer(uintptr_t v, const LogFormatString::Spec& spec);
+
+    static const size_t kNumberSize = 64;
+    static char* ToChars(char* first, char* last, long long v);
+    static char* ToChars(char* first, char* last, unsigned long long v);
+    static char* ToChars(char* first, char* last, long v) { return ToChars(first, last, (long long)v); }
+    static char* ToChars(char* first, char* last, unsigned long v) { return ToChars(first, last, (unsigned long long)v); }
+    static char* ToChars(char* first, char* last, int v) { return ToChars(first, last, (long long)v); }
+    static char* ToChars(char* first, char* last, unsigned int v) { return ToChars(first, last, (unsigned long long)v); }
+    static char* ToChars(char* first, char* last, short v) { return ToChars(first, last, (long long)v); }
+    static char* ToChars(char* first, char* last, unsigned short v) {
+        return ToChars(first, last, (unsigned long long)v);
+    }
+    // 与std::ostream默认格式(%g, 精度6)一致
+    static char* ToChars(char* first, char* last, double v);
+    static char* ToChars(char* first, char* last, long double v);
+
+   private:
+    LogStreamBuf m_buf;
+    // 首次需要时才构造
+    std::optional<std::ostream> m_stream;
+    bool m_formatted = false;
+    // kv写入的字段(所属日志事件的字段)
+    LogFields* m_fields = nullptr;
+};
+
+// 线程局部的日志事件对象池，定义见log.cpp
+class LogEventPool;
+
 // 日志事件
 class LogEvent {
+    friend class LogEventPool;
+    friend class LogFormatter;
+
    public:
     typedef std::shared_ptr<LogEvent> ptr;
+    // 从当前线程的对象池中获取日志事件，释放时回收到对象池(控制块同样来自对象池)
+    // 内容不超过LogStreamBuf::kInlineSize时，整个过程不需要申请堆内存
+    static ptr Create(const std::shared_ptr<Logger>& logger, LogLevel::Level level, const char* file, int32_t line,
+                      uint32_t thread_id, uint32_t fiber_id, const struct timespec& time);
     LogEvent(std::shared_ptr<Logger> logger, LogLevel::Level level, const char* file, int32_t line, uint32_t elapse,
              uint32_t thread_id, uint32_t fiber_id, uint64_t time);
+    // 纳秒精度的时间戳，累计耗时根据时间戳计算
+    LogEvent(std::shared_ptr<Logger> logger, LogLevel::Level level, const char* file, int32_t line, uint32_t thread_id,
+             uint32_t fiber_id, const struct timespec& time);
     //  ~LogEvent();
 
     const char* getFile() const { return m_file; }
     int32_t getLine() const { return m_line; }
-    uint32_t getElapse() const { return m_elapse; }
+    // 累计耗时(毫秒)
+    uint32_t getElapse() const { return m_elapse / 1000000; }
+    uint64_t getElapseNs() const { return m_elapse; }
+    // 离线解码时恢复纳秒精度的时间戳与耗时
+    void setTimeNs(uint64_t val) {
+        m_time = val / 1000000000;
+        m_nsec = val % 1000000000;
+    }
+    void setElapseNs(uint64_t val) { m_elapse = val; }
     uint32_t getThreadId() const { return m_threadId; }
+    // 线程名称(Create时取当前线程的名称)
+    const char* getThreadName() const { return m_threadName; }
+    void setThreadName(const char* val) { m_threadName = val; }
     uint32_t getFiberId() const { return m_fiberId; }
     uint64_t getTime() const { return m_time; }
-    const std::string getContent() const { return m_ss.str(); }
-    std::stringstream& getSS() { return m_ss; }
-    std::shared_ptr<Logger> getLogger() const { return m_logger; }
+    // 时间戳中秒以下的部分(纳秒)
+    uint32_t getNsec() const { return m_nsec; }
+    // 纳秒时间戳
+    uint64_t getTimeNs() const { return m_time * 1000000000ULL + m_nsec; }
+    // 日志内容，延迟格式化的参数在这里才真正格式化，结构化字段以 " key=value" 附加在最后
+    const std::string getContent() const;
+    // 将日志内容追加到out
+    void appendContent(std::string& out) const;
+    // 结构化字段
+    LogFields& getFields() { return m_fields; }
+    const LogFields& getFields() const { return m_fields; }
+    // 流式写入的内容(不包括延迟格式化的参数)
+    LogStream& getSS() { return m_ss; }
+    const LogStream& getSS() const { return m_ss; }
+    const std::shared_ptr<Logger>& getLogger() const { return m_logger; }
     LogLevel::Level getLevel() const { return m_level; }
+    LogArgs& getArgs() { return m_args; }
+    const LogArgs& getArgs() const { return m_args; }
+    // 延迟格式化：只记录格式串和参数，输出时再按printf语义格式化
+    // 只保存fmt的指针，fmt必须在事件释放之前一直有效(字符串字面量或者静态存储)
+    template <class... Args>
+    void format(const char* fmt, const Args&... args) {
+        if (!m_args.empty()) {
+            // 多次调用时先将之前的参数格式化到内容中
+            flushArgs();
+        }
+        m_args.capture(fmt, args...);
+    }
+    // 同format，literal为false时(格式串不是字符串字面量，见MYLOG_LOG_FMT_LEVEL)立即格式化，不保存fmt的指针
+    template <class... Args>
+    void formatPrintf(bool literal, const char* fmt, const Args&... args) {
+        format(fmt, args...);
+        if (!literal) {
+            flushArgs();
+        }
+    }
     //  使用可变参数 ...
-    void format(const char* fmt, ...);
     void format(const char* fmt, va_list al);
+    // 是否缓存格式化结果(Logger分发给多个Appender前设置，见LogFormatter::formatCached)
+    void setFormatCache(bool val) { m_formatCache = val; }
+
+   private:
+    void flushArgs();
+    // 对象池复用时重新设置各字段
+    void reset(const std::shared_ptr<Logger>& logger, LogLevel::Level level, const char* file, int32_t line,
+               uint32_t thread_id, uint32_t fiber_id, const struct timespec& time);
+    // 回收到对象池前释放引用并清空内容
+    void recycle();
 
    private:
     std::shared_ptr<Logger> m_logger;
@@ -100,16 +715,29 @@ class LogEvent {
     const char* m_file = nullptr;
     // 日志行号
     int32_t m_line = 0;
-    // 累计耗时：程序启动到现在的时间长度(毫秒数)
-    uint32_t m_elapse = 0;
+    // 累计耗时：程序启动到现在的时间长度(纳秒)
+    uint64_t m_elapse = 0;
     // 线程ID
     uint32_t m_threadId = 0;
+    // 线程名称(GetThreadName返回的字符串，不需要释放)
+    const char* m_threadName = "";
     // 协程ID
     uint32_t m_fiberId = 0;
     // 时间戳
     uint64_t m_time = 0;
+    uint32_t m_nsec = 0;
     // 日志内容
-    std::stringstream m_ss;
+    LogStream m_ss;
+    // 延迟格式化的参数
+    LogArgs m_args;
+    // 结构化字段
+    LogFields m_fields;
+    // 格式化结果的缓存，只在调用Logger::log的线程中读写
+    bool m_formatCache = false;
+    // 缓存结果对应的formatter编号(0表示没有缓存)与级别
+    uint64_t m_formattedId           = 0;
+    LogLevel::Level m_formattedLevel = LogLevel::UNKNOWN;
+    std::string m_formatted;
 };
 
 // 实现LogEvent可以将自己析构时写入logger
@@ -117,21 +745,90 @@ class LogEventWrap {
    public:
     LogEventWrap(LogEvent::ptr e);
     ~LogEventWrap();
-    std::stringstream& getSS();
-    LogEvent::ptr getEvent() const { return m_event; }
+    LogStream& getSS();
+    const LogEvent::ptr& getEvent() const { return m_event; }
 
    private:
     LogEvent::ptr m_event;
 };
 
+/**
+ * 日志限流状态(无锁)
+ * 用于每个调用处(MYLOG_LOG_EVERY_N等宏)以及日志器的限流(Logger::setRateLimit)
+ * 被抑制的日志只增加计数；everyN、firstN一直被抑制时，每隔kSummaryIntervalNs仍然放行一条，
+ * 由输出方带上抑制的次数(takeSuppressed)，所以被抑制的数量会周期性地出现在日志中
+ * everyN、firstN被抑制时不读取时钟，每kSummaryCheck次抑制才检查一次汇总间隔
+ */
+class LogLimiter {
+   public:
+    // 汇总被抑制次数的最长间隔
+    static const uint64_t kSummaryIntervalNs = 10ull * 1000 * 1000 * 1000;
+    // everyN、firstN每抑制多少次检查一次汇总间隔
+    static const uint64_t kSummaryCheck = 1024;
+
+    constexpr LogLimiter() {}
+    LogLimiter(const LogLimiter&) = delete;
+    LogLimiter& operator=(const LogLimiter&) = delete;
+
+    // 每n次放行一次(第1、n+1、2n+1...次)
+    bool everyN(uint64_t n);
+    // 只放行前n次
+    bool firstN(uint64_t n);
+    // 每ms毫秒最多放行一次
+    bool everyMs(uint64_t ms);
+    // 令牌桶: 平均每秒最多rate次，最多连续放行burst次
+    bool tokenBucket(double rate, uint64_t burst);
+    // 令牌桶: 每interval纳秒一个令牌
+    bool tokenBucketNs(uint64_t interval, uint64_t burst);
+
+    // 取出并清零被抑制的次数
+    uint64_t takeSuppressed() { return m_suppressed.exchange(0, std::memory_order_relaxed); }
+    // 被抑制过时在日志内容前写入 "[suppressed N] "
+    LogStream& prefix(LogStream& ss);
+
+    // 单调时钟(纳秒)
+    static uint64_t NowNs();
+
+   private:
+    // 放行，记录放行时间
+    bool pass(uint64_t now);
+    // 记录一次抑制(everyMs、令牌桶本身会周期性放行，不需要汇总)
+    bool suppress();
+    // 记录一次抑制(everyN、firstN)，距离上次放行超过汇总间隔时改为放行
+    bool suppressCounted();
+
+   private:
+    // 调用次数(everyN、firstN)
+    std::atomic<uint64_t> m_count{0};
+    // 上次放行后被抑制的次数
+    std::atomic<uint64_t> m_suppressed{0};
+    // 上次放行的时间，0表示还没有放行过
+    std::atomic<uint64_t> m_last{0};
+    // 令牌桶(GCRA)的理论到达时间
+    std::atomic<uint64_t> m_tat{0};
+};
+
 // 日志格式器
 class LogFormatter {
    public:
     typedef std::shared_ptr<LogFormatter> ptr;
+    // 编译期生成的格式化函数(见log_static.h)
+    typedef void (*RenderFunc)(std::string& out, LogLevel::Level level, const LogEvent& event);
     LogFormatter(const std::string& pattern);
+    // render不为空时格式化直接调用render，pattern只用于输出配置
+    LogFormatter(const std::string& pattern, RenderFunc render);
     //  ~LogFormatter();
 
     std::string format(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event);
+    // 执行编译后的格式化指令，结果直接追加到调用方提供的缓冲区out，不经过iostream
+    void format(std::string& out, const std::shared_ptr<Logger>& logger, LogLevel::Level level,
+                const LogEvent::ptr& event);
+    // 同format，事件开启缓存时(输出到多个Appender)按照formatter编号与级别缓存结果，
+    // 共用同一个formatter的Appender只格式化一次；只能在调用Logger::log的线程中使用(defer模式的后台线程调用format)
+    void formatCached(std::string& out, const std::shared_ptr<Logger>& logger, LogLevel::Level level,
+                      const LogEvent::ptr& event);
+    // 逐个调用FormatItem的虚函数写入输出流(编译前的实现，用于对比和兼容)
+    std::string formatItems(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event);
 
     // 解析日志格式
     void init();
@@ -140,6 +837,60 @@ class LogFormatter {
     bool isError() const { return m_error; }
 
     const std::string getPattern() const { return m_pattern; }
+    // 进程内唯一的编号，用于识别同一个formatter(地址可能被释放后复用)
+    uint64_t getId() const { return m_id; }
+
+    // 按照配置创建: JsonFormatter::kName 创建JsonFormatter，否则为格式串
+    static LogFormatter::ptr Create(const std::string& pattern);
+
+    // 格式化时使用的基础转换函数，编译期格式(StaticFormatter)与运行期格式共用，保证输出一致
+    static void AppendUInt(std::string& out, uint64_t v) {
+        char buf[20];
+        char* p = buf + sizeof(buf);
+        do {
+            *--p = '0' + v % 10;
+            v /= 10;
+        } while (v);
+        out.append(p, buf + sizeof(buf) - p);
+    }
+    static void AppendInt(std::string& out, int64_t v) {
+        if (v < 0) {
+            out.append(1, '-');
+            AppendUInt(out, -static_cast<uint64_t>(v));
+        } else {
+            AppendUInt(out, v);
+        }
+    }
+    // 按照strftime格式输出日期，另外支持 %L 毫秒、%f 微秒、%N 纳秒(补齐位数)
+    // 渲染结果按线程缓存，同一分钟内只修改秒和秒以下的数字，不再调用localtime_r/strftime
+    static void AppendDateTime(std::string& out, const char* fmt, time_t time, uint32_t nsec = 0);
+    // %r{单位} 累计耗时的精度: ms(默认)、us、ns，返回纳秒换算为该单位的除数
+    static constexpr uint32_t ElapseDivisor(const char* unit, size_t len) {
+        if (len == 2 && unit[1] == 's') {
+            if (unit[0] == 'u') {
+                return 1000;
+            }
+            if (unit[0] == 'n') {
+                return 1;
+            }
+        }
+        return 1000000;
+    }
+
+    // 编译后的格式化指令
+    enum OpCode {
+        OP_LITERAL = 0,
+        OP_MESSAGE,
+        OP_LEVEL,
+        OP_ELAPSE,
+        OP_NAME,
+        OP_THREAD_ID,
+        OP_FIBER_ID,
+        OP_DATETIME,
+        OP_FILENAME,
+        OP_LINE,
+        OP_THREAD_NAME
+    };
 
    public:
     // 虚子类 用于定义各种日志格式
@@ -153,38 +904,128 @@ class LogFormatter {
                             LogEvent::ptr event) = 0;
     };
 
+   private:
+    struct Op {
+        OpCode code;
+        // OP_LITERAL: 在m_literals中的位置与长度；OP_DATETIME: m_dateFormats的下标；OP_ELAPSE: 单位的除数
+        uint32_t offset;
+        uint32_t len;
+    };
+    // 根据解析结果生成指令，相邻的文本(包括%T、%n)合并为一条OP_LITERAL
+    void compile(const std::vector<std::tuple<std::string, std::string, int>>& vec);
+
     // 具体的子类
    private:
     // 当前日志格式
     std::string m_pattern;
     // 各种日志格式
     std::vector<FormatItem::ptr> m_items;
+    // 编译后的指令
+    std::vector<Op> m_program;
+    // 所有文本指令的内容
+    std::string m_literals;
+    // 日期格式
+    std::vector<std::string> m_dateFormats;
+    // 编译期生成的格式化函数
+    RenderFunc m_render = nullptr;
+    uint64_t m_id;
     // 异常情况
     bool m_error;
 };
 
+// JSON格式，每条日志输出为一行JSON对象(JSON Lines):
+// {"time":"2024-02-25T19:34:51.123456","level":"INFO","logger":"root","thread":123,"thread_name":"main",
+//  "fiber":0,"file":"t.cpp","line":7,"message":"...", 结构化字段...}
+// 结构化字段在标准字段之后按照添加顺序输出，保留数值类型
+class JsonFormatter : public LogFormatter {
+   public:
+    typedef std::shared_ptr<JsonFormatter> ptr;
+    // 配置中的格式名称(formatter: json)
+    static constexpr const char* kName = "json";
+
+    JsonFormatter() : LogFormatter(kName, &Render) {}
+
+    static void Render(std::string& out, LogLevel::Level level, const LogEvent& event);
+    // 转义后写入out(不包括两侧的引号)
+    static void AppendEscaped(std::string& out, const char* data, size_t len);
+};
+
 // 日志输出地
-class LogAppender {
+// Appender的刷新策略，全部为默认值时只在缓冲区写满时写入
+// StdoutLogAppender、FileLogAppender、BinaryFileLogAppender默认ERROR及以上的日志立即刷新
+struct LogFlushPolicy {
+    // 每写入every条日志刷新一次
+    uint32_t every = 0;
+    // 距离上次刷新超过interval毫秒时刷新，写入日志时检查，停止写入后由刷新线程定时刷新
+    uint32_t interval = 0;
+    // 该级别及以上的日志写入后立即刷新，UNKNOWN表示不启用
+    LogLevel::Level level = LogLevel::UNKNOWN;
+    // 该级别及以上的日志刷新后再fdatasync，UNKNOWN表示不启用
+    LogLevel::Level sync_level = LogLevel::UNKNOWN;
+
+    bool operator==(const LogFlushPolicy& oth) const {
+        return every == oth.every && interval == oth.interval && level == oth.level && sync_level == oth.sync_level;
+    }
+};
+
+class LogAppender : public std::enable_shared_from_this<LogAppender> {
     friend class Logger;
+    friend class LogFlushTimer;
 
    public:
     typedef std::shared_ptr<LogAppender> ptr;
+    // 格式化期间持有formatter，不会被并发的setFormatter释放
+    typedef RcuValue<LogFormatter::ptr>::ReadLock FormatterLock;
     //  LogAppender();
     virtual ~LogAppender();
     virtual void log(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr event) = 0;
     virtual std::string toYamlString()                                                           = 0;
+    // 输出一批日志(各事件的级别为getLevel())，默认逐条调用log
+    // StdoutLogAppender、FileLogAppender把整批格式化到一块连续的缓冲区后一次写入
+    virtual void logBatch(std::shared_ptr<Logger> logger, const LogEvent::ptr* events, size_t count);
     void setFormatter(LogFormatter::ptr val);
-    LogFormatter::ptr getFormatter() const { return m_formatter; }
+    LogFormatter::ptr getFormatter() const { return m_formatter.load(); }
     LogLevel::Level getLevel() const { return m_level; }
     void setLevel(LogLevel::Level val) { m_level = val; }
+    // 设置interval时由刷新线程定时刷新(只对shared_ptr管理的Appender有效)
+    void setFlushPolicy(const LogFlushPolicy& val);
+    LogFlushPolicy getFlushPolicy() const;
+
+   protected:
+    // 写入一条日志后需要的刷新操作
+    enum FlushAction { FLUSH_NONE = 0, FLUSH_WRITE = 1, FLUSH_SYNC = 2 };
+    // 按照刷新策略判断写入level级别的日志后需要的操作
+    FlushAction flushAction(LogLevel::Level level);
+    // 将文件已经写入内核的数据同步到磁盘(用于拿不到文件描述符的ofstream)
+    static void SyncFile(const std::string& filename);
+    // 非默认的刷新策略写入flush节点(各Appender的toYamlString)
+    void flushPolicyToYaml(YAML::Node& node) const;
+    // 将缓冲区中的日志写入内核(同FLUSH_WRITE)，interval到期后由刷新线程调用
+    // 日志直接写入内核或者有自己的后台线程的Appender不需要实现
+    virtual void flushWrite() {}
 
    protected:
     // 针对哪些日志的等级
     LogLevel::Level m_level = LogLevel::DEBUG;  // 需要初始化
-    // 处理不同日志格式
-    LogFormatter::ptr m_formatter;
+    // 处理不同日志格式，可以在其他线程输出日志时替换
+    RcuValue<LogFormatter::ptr> m_formatter;
     // 记录当前日志formatter的情况
-    bool m_hasFormatter = false;
+    std::atomic<bool> m_hasFormatter{false};
+
+   private:
+    // 刷新策略(可以在输出日志时修改)，m_flushEnabled为false时不需要判断
+    std::atomic<bool> m_flushEnabled{false};
+    std::atomic<uint32_t> m_flushEvery{0};
+    std::atomic<uint32_t> m_flushEveryMs{0};
+    std::atomic<LogLevel::Level> m_flushLevel{LogLevel::UNKNOWN};
+    std::atomic<LogLevel::Level> m_syncLevel{LogLevel::UNKNOWN};
+    // 上次刷新后写入的条数、上次刷新的时间(毫秒)
+    std::atomic<uint32_t> m_flushCount{0};
+    std::atomic<uint64_t> m_lastFlushMs{0};
+    // 上次刷新后是否写入过日志(设置interval时)
+    std::atomic<bool> m_flushDirty{false};
+    // 是否已经交给刷新线程
+    std::atomic<bool> m_flushTimer{false};
 };
 
 // 日志输出器
@@ -197,6 +1038,9 @@ class Logger : public std::enable_shared_from_this<Logger> {
     //  ~Logger();
 
     void log(LogLevel::Level level, LogEvent::ptr event);
+    // 输出一批日志(各事件的级别为getLevel())，每个Appender只调用一次logBatch
+    void log(const LogEvent::ptr* events, size_t count);
+    void log(const std::vector<LogEvent::ptr>& events) { log(events.data(), events.size()); }
 
     // 日志级别方法
     void debug(LogEvent::ptr event);
@@ -205,25 +1049,51 @@ class Logger : public std::enable_shared_from_this<Logger> {
     void error(LogEvent::ptr event);
     void fatal(LogEvent::ptr event);
 
+    // 修改Appender集合时复制一份新的集合再整体替换，正在输出日志的线程不受影响
     void addAppender(LogAppender::ptr appender);
     void delAppender(LogAppender::ptr appender);
     void clearAppenders();
-    LogLevel::Level getLevel() const { return m_level; }
-    void setLevel(LogLevel::Level val) { m_level = val; }
-    const std::string getName() const { return m_name; }
+    // 一次替换全部Appender(配置重新加载时使用，不会出现Appender为空的中间状态)
+    void setAppenders(const std::vector<LogAppender::ptr>& appenders);
+    LogLevel::Level getLevel() const { return m_level.load(std::memory_order_relaxed); }
+    void setLevel(LogLevel::Level val) { m_level.store(val, std::memory_order_relaxed); }
+    // level级别的日志是否需要输出
+    bool isEnabled(LogLevel::Level level) const { return level >= m_level.load(std::memory_order_relaxed); }
+    // 日志器的限流: 平均每秒最多rate条，最多连续burst条，rate为0时不限流
+    // 被抑制的日志在下一条输出的日志之前汇总为一条日志
+    void setRateLimit(double rate, uint64_t burst);
+    double getRateLimit() const;
+    uint64_t getRateBurst() const { return m_limitBurst.load(std::memory_order_relaxed); }
+    const std::string& getName() const { return m_name; }
     void setFormatter(LogFormatter::ptr val);
     void setFormatter(const std::string& val);
     LogFormatter::ptr getFormatter();
     std::string toYamlString();
 
    private:
-    // Appender集合
-    std::list<LogAppender::ptr> m_appenders;
+    // 级别与日志器限流的判断，通过时返回true；需要先输出被抑制数量的汇总时设置summary
+    bool filter(LogLevel::Level level, const LogEvent::ptr& event, LogEvent::ptr& summary);
+    // 交给Appender输出(没有Appender时交给root)
+    void dispatch(LogLevel::Level level, const LogEvent::ptr& event);
+    void dispatch(const LogEvent::ptr* events, size_t count);
+    // 为没有formatter的appender设置日志器的formatter
+    void inheritFormatter(const LogAppender::ptr& appender, const LogFormatter::ptr& formatter);
+
+   private:
+    // 日志器的级别(配置重新加载时会在其他线程修改)
+    // 每条日志语句都会读取，单独占用一个缓存行，不受其他成员写入的影响
+    alignas(MYLOG_CACHE_LINE_SIZE) std::atomic<LogLevel::Level> m_level;
+    // Appender集合(不可变的快照)，读取计数在输出日志时频繁写入
+    alignas(MYLOG_CACHE_LINE_SIZE) RcuValue<std::vector<LogAppender::ptr>> m_appenders;
+    // 修改Appender集合、formatter的写入方互斥，不影响输出日志
+    std::mutex m_mutex;
     // 日志名称
     std::string m_name;
-    // 日志器的级别
-    LogLevel::Level m_level;
-    LogFormatter::ptr m_formatter;
+    RcuValue<LogFormatter::ptr> m_formatter;
+    // 限流的令牌间隔(纳秒)，0表示不限流
+    std::atomic<uint64_t> m_limitInterval{0};
+    std::atomic<uint64_t> m_limitBurst{0};
+    LogLimiter m_limiter;
     // 日志配置，默认为root，配置后由配置项设置
     Logger::ptr m_root;
 };
@@ -232,10 +1102,13 @@ class Logger : public std::enable_shared_from_this<Logger> {
 class StdoutLogAppender : public LogAppender {
    public:
     typedef std::shared_ptr<StdoutLogAppender> ptr;
+    StdoutLogAppender();
     void log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) override;
+    void logBatch(Logger::ptr logger, const LogEvent::ptr* events, size_t count) override;
     std::string toYamlString() override;
 
    private:
+    void flushWrite() override;
 };
 
 // 输出到文件的Appender
@@ -244,26 +1117,353 @@ class FileLogAppender : public LogAppender {
     typedef std::shared_ptr<FileLogAppender> ptr;
     FileLogAppender(const std::string& filename);
     void log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) override;
+    void logBatch(Logger::ptr logger, const LogEvent::ptr* events, size_t count) override;
     std::string toYamlString() override;
     // 文件的重复打开, 打开成功返回true
     bool reopen();
 
+   private:
+    void flushWrite() override;
+
    private:
     std::string m_filename;
+    // 多个线程同时写入文件流
+    std::mutex m_mutex;
     std::ofstream m_filestream;
 };
 
+/**
+ * 通过内存映射输出到文件的Appender
+ * 文件按照segment_size分段预先分配(fallocate)并映射，格式化后的日志直接memcpy到映射区域，
+ * 一段写满后再分配、映射下一段；输出日志时没有write系统调用
+ * 脏页由内核持有，进程崩溃后日志仍然会写回文件；正常关闭时截掉末尾未使用的部分，
+ * 崩溃后文件末尾可能留下'\0'，重新打开时从最后一个非'\0'字节之后继续写入
+ */
+class MmapFileLogAppender : public LogAppender {
+   public:
+    typedef std::shared_ptr<MmapFileLogAppender> ptr;
+    // 一段写满(以及flush)时的msync策略
+    enum SyncPolicy {
+        // 交给内核按照脏页回写策略写回
+        SYNC_NONE = 0,
+        // msync(MS_ASYNC)，发起写回但不等待
+        SYNC_ASYNC = 1,
+        // msync(MS_SYNC)，等待写回完成
+        SYNC_SYNC = 2
+    };
+    static const char* SyncToString(SyncPolicy policy);
+    // 无法识别时返回SYNC_NONE
+    static SyncPolicy SyncFromString(const std::string& str);
+
+    // segment_size: 每段的大小，向上取整为页大小的整数倍
+    // advise: 映射时madvise(MADV_SEQUENTIAL)，一段写满后madvise(MADV_DONTNEED)释放进程占用的页
+    MmapFileLogAppender(const std::string& filename, size_t segment_size = 32 * 1024 * 1024,
+                        SyncPolicy sync = SYNC_NONE, bool advise = true);
+    ~MmapFileLogAppender();
+    void log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) override;
+    std::string toYamlString() override;
+    // 将已经写入的日志同步到磁盘
+    void flush();
+
+   private:
+    // 打开文件，从已有数据的末尾继续写入
+    bool openFile();
+    // 分配并映射从m_base开始的一段(调用方持有m_mutex)
+    bool mapSegment();
+    // 按照策略同步并解除当前段的映射(调用方持有m_mutex)
+    void unmapSegment();
+    // 写入数据，跨段时切换到下一段，映射失败后改用pwrite(调用方持有m_mutex)
+    void append(const char* data, size_t len);
+    // 将已经写入的数据同步到磁盘(调用方持有m_mutex)
+    void sync();
+
+   private:
+    std::string m_filename;
+    size_t m_segmentSize;
+    SyncPolicy m_sync;
+    bool m_advise;
+
+    std::mutex m_mutex;
+    int m_fd = -1;
+    // 当前段在文件中的偏移(页对齐)
+    uint64_t m_base = 0;
+    // 当前段的映射，nullptr表示没有映射(映射失败后改用pwrite写入)
+    char* m_data = nullptr;
+    // 当前段内已经写入的长度(pwrite写入时可能超过段的大小)
+    size_t m_pos = 0;
+};
+
+/**
+ * 滚动输出到文件的Appender
+ * 按照大小、按照时间(每小时/每天)或者同时按照两者切换文件，当前文件始终为filename，
+ * 切换时重命名为 filename.YYYYmmdd-HHMMSS.序号，只保留最新的max_files个归档；
+ * 归档的gzip压缩与清理在后台线程进行，输出日志的线程只需要rename和重新打开文件
+ * 收到SIGHUP时重新打开文件(配合logrotate的postrotate使用)
+ */
+class RollingFileLogAppender : public LogAppender {
+   public:
+    typedef std::shared_ptr<RollingFileLogAppender> ptr;
+    // 按照时间切换的周期
+    enum RollInterval { NONE = 0, HOURLY = 1, DAILY = 2 };
+    static const char* IntervalToString(RollInterval interval);
+    // 无法识别时返回NONE
+    static RollInterval IntervalFromString(const std::string& str);
+
+    // max_size: 单个文件的最大字节数，0表示不按照大小切换
+    // max_files: 保留的归档数量，0表示全部保留
+    // compress: 是否使用gzip压缩归档
+    RollingFileLogAppender(const std::string& filename, uint64_t max_size = 0, RollInterval interval = DAILY,
+                           uint32_t max_files = 0, bool compress = false);
+    ~RollingFileLogAppender();
+    void log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) override;
+    std::string toYamlString() override;
+    // 重新打开文件(不切换)，打开成功返回true
+    bool reopen();
+    // 立即切换文件
+    void rollover();
+    // 等待后台线程处理完已经切换的归档
+    void waitArchived();
+
+   private:
+    // 打开当前文件并计算下一次按照时间切换的时间(调用方持有m_mutex)
+    bool openFile();
+    // 切换文件(调用方持有m_mutex)
+    void rollFile(time_t now);
+    // 后台线程: 压缩归档、删除多余的归档
+    void run();
+    // 压缩归档，成功后删除原文件
+    void compressFile(const std::string& path);
+    // 删除超出max_files的最旧的归档
+    void removeOldFiles();
+
+   private:
+    std::string m_filename;
+    uint64_t m_maxSize;
+    RollInterval m_interval;
+    uint32_t m_maxFiles;
+    bool m_compress;
+
+    std::mutex m_mutex;
+    int m_fd = -1;
+    // 当前文件的大小
+    uint64_t m_size = 0;
+    // 下一次按照时间切换的时间，0表示不按照时间切换
+    time_t m_nextRoll = 0;
+    // 同一秒内多次切换时的序号
+    time_t m_lastRoll = 0;
+    uint32_t m_rollSeq = 0;
+    // 已经处理的SIGHUP次数
+    uint64_t m_sighupSeq = 0;
+
+    // 等待后台线程处理的归档
+    std::mutex m_archiveMutex;
+    std::condition_variable m_archiveCond;
+    std::vector<std::string> m_archives;
+    // 后台线程正在处理的归档数量
+    size_t m_archiving = 0;
+    bool m_stopping    = false;
+    std::thread m_thread;
+};
+
+// 异步输出到文件的Appender
+// 调用线程只负责格式化并写入前台缓冲区，后台线程交换前后台缓冲区后批量写入文件
+class AsyncLogAppender : public LogAppender {
+   public:
+    typedef std::shared_ptr<AsyncLogAppender> ptr;
+    // 前台缓冲区写满时的处理策略
+    enum FullPolicy {
+        // 阻塞调用线程，直到后台线程腾出缓冲区
+        BLOCK = 0,
+        // 直接丢弃日志
+        DROP = 1,
+        // 丢弃日志并计数，由后台线程输出丢弃条数
+        DROP_COUNT = 2
+    };
+    static const char* PolicyToString(FullPolicy policy);
+    // 无法识别时返回BLOCK
+    static FullPolicy PolicyFromString(const std::string& str);
+
+    // buffer_size: 单个缓冲区大小(字节)，内存占用上限为两倍buffer_size
+    // flush_interval: 后台线程最长的写入间隔(毫秒)
+    // defer: 为true时调用线程只保存日志事件，格式化也交给后台线程
+    // uring: 为true时交给进程内共用的LogIoService写入，多个文件的写入合并为一次io_uring提交
+    AsyncLogAppender(const std::string& filename, size_t buffer_size = 4 * 1024 * 1024, uint32_t flush_interval = 1000,
+                     FullPolicy policy = BLOCK, bool defer = false, bool uring = false);
+    ~AsyncLogAppender();
+    void log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) override;
+    std::string toYamlString() override;
+    // 将调用前写入的日志全部落盘后返回
+    void flush();
+    // 累计丢弃的日志条数
+    uint64_t getDropped() const { return m_dropped; }
+
+   private:
+    // 缓冲区：格式化好的文本，或者defer模式下等待格式化的日志事件
+    struct Buffer {
+        std::string text;
+        std::vector<std::pair<LogLevel::Level, LogEvent::ptr>> events;
+        // 占用的字节数(日志事件按估算大小计算)
+        size_t bytes = 0;
+
+        bool empty() const { return bytes == 0; }
+        void swap(Buffer& oth) {
+            text.swap(oth.text);
+            events.swap(oth.events);
+            std::swap(bytes, oth.bytes);
+        }
+        void clear() {
+            text.clear();
+            events.clear();
+            bytes = 0;
+        }
+    };
+
+    // 后台写入线程
+    void run();
+    // 写入整个缓冲区，处理部分写入的情况
+    void writeAll(const char* data, size_t len);
+
+   private:
+    std::string m_filename;
+    int m_fd = -1;
+    size_t m_bufferSize;
+    uint32_t m_flushInterval;
+    FullPolicy m_policy;
+    bool m_defer;
+    bool m_uring;
+    // 最后一次提交给LogIoService的写入序号
+    uint64_t m_ioSeq = 0;
+
+    std::mutex m_mutex;
+    // 唤醒后台线程
+    std::condition_variable m_cond;
+    // 通知等待中的生产者与flush调用者
+    std::condition_variable m_doneCond;
+    // 前台缓冲区(生产者写入)
+    Buffer m_front;
+    // 后台缓冲区(后台线程写入文件)
+    Buffer m_back;
+    // 已交换到后台的缓冲区序号
+    uint64_t m_swapSeq = 0;
+    // 已写入文件的缓冲区序号
+    uint64_t m_writtenSeq = 0;
+    // 是否有flush请求
+    bool m_flushRequest = false;
+    bool m_stopping     = false;
+    std::atomic<uint64_t> m_dropped{0};
+    // 已经输出过的丢弃条数
+    uint64_t m_reportedDropped = 0;
+    std::thread m_thread;
+};
+
+// 单生产者单消费者的环形缓冲区，定义见log.cpp
+class LogRing;
+
+// 每个写日志的线程拥有独立的无锁环形缓冲区(SPSC)，由一个消费线程按时间戳顺序汇总写入文件
+// 环形缓冲区写满时直接丢弃并计数，写日志的线程之间不会相互竞争
+class RingLogAppender : public LogAppender {
+   public:
+    typedef std::shared_ptr<RingLogAppender> ptr;
+    // filename 为空时输出到标准输出
+    // ring_size: 每个线程的环形缓冲区大小(字节)
+    // flush_interval: 消费线程空闲时的轮询间隔(毫秒)
+    RingLogAppender(const std::string& filename, size_t ring_size = 1024 * 1024, uint32_t flush_interval = 10);
+    ~RingLogAppender();
+    void log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) override;
+    std::string toYamlString() override;
+    // 将调用前写入的日志全部落盘后返回
+    void flush();
+    // 各线程(线程ID)环形缓冲区的溢出(丢弃)条数
+    std::map<uint32_t, uint64_t> getOverflowCounts();
+    // 累计溢出条数, 包括已经退出的线程
+    uint64_t getOverflowTotal();
+
+   private:
+    // 获取当前线程的环形缓冲区，首次调用时注册
+    LogRing* getRing();
+    // 消费线程
+    void run();
+    // 按时间戳顺序取出所有环形缓冲区中的日志并写入文件
+    void drain(std::vector<std::shared_ptr<LogRing>>& rings);
+    void writeAll(const char* data, size_t len);
+
+   private:
+    std::string m_filename;
+    int m_fd = -1;
+    size_t m_ringSize;
+    uint32_t m_flushInterval;
+    // 区分不同的appender实例(线程局部的缓冲区表以它为key)
+    uint64_t m_id;
+    // 线程局部的缓冲区表通过它判断appender是否已经析构
+    std::shared_ptr<char> m_token;
+
+    // 保护 m_rings / m_retiredOverflow / flush 相关状态
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::vector<std::shared_ptr<LogRing>> m_rings;
+    uint64_t m_retiredOverflow = 0;
+    uint64_t m_flushRequest    = 0;
+    uint64_t m_flushDone       = 0;
+    bool m_stopping            = false;
+    // 消费线程合并后的输出缓冲
+    std::string m_out;
+    std::thread m_thread;
+};
+
+// 日志管理器
+// 日志器注册表：只增不删的哈希表
+// 查找不加锁、不等待(wait-free)，插入由互斥锁串行化；
+// 扩容时发布新的桶数组，旧的桶数组与节点保留到析构，读取方拿到的桶数组一直有效
+class LoggerRegistry {
+   public:
+    LoggerRegistry();
+    ~LoggerRegistry();
+    LoggerRegistry(const LoggerRegistry&) = delete;
+    LoggerRegistry& operator=(const LoggerRegistry&) = delete;
+
+    // 没有找到时返回nullptr
+    const Logger::ptr* find(std::string_view name) const;
+    // 插入日志器，同名的日志器已经存在时返回已有的日志器
+    const Logger::ptr& insert(const Logger::ptr& logger);
+    // 所有日志器
+    std::vector<Logger::ptr> list() const;
+
+   private:
+    struct Node {
+        std::string name;
+        size_t hash;
+        Logger::ptr logger;
+        std::atomic<Node*> next{nullptr};
+    };
+    struct Table {
+        size_t mask;
+        std::unique_ptr<std::atomic<Node*>[]> buckets;
+    };
+    // 按照hash插入到表中(调用方持有m_mutex)
+    Node* link(Table* table, const std::string& name, size_t hash, const Logger::ptr& logger);
+
+   private:
+    std::atomic<Table*> m_table;
+    std::mutex m_mutex;
+    size_t m_size = 0;
+    // 所有的桶数组与节点，析构时释放
+    std::vector<Table*> m_tables;
+    std::vector<Node*> m_nodes;
+};
+
 // 日志管理器
+// 日志器创建后不会删除(配置删除日志器时只清空Appender)，可以在调用处缓存(MYLOG_LOG_NAME_CACHED)
 class LoggerManager {
    public:
     LoggerManager();
-    Logger::ptr getLogger(const std::string& name);
+    // 可以在多个线程中调用，已经存在的日志器查找不加锁
+    Logger::ptr getLogger(std::string_view name);
     void init();
-    Logger::ptr getRoot() const { return m_root; }
+    const Logger::ptr& getRoot() const { return m_root; }
     std::string toYamlString();
 
    private:
-    std::map<std::string, Logger::ptr> m_loggers;
+    LoggerRegistry m_loggers;
     Logger::ptr m_root;
 };
 
@@ -0,0 +1,548 @@
+#include "log_binary.h"
+
+#include <yaml-cpp/yaml.h>
+
+namespace mylog {
+
+const char* BinaryLogEncoder::kMagic = "MYLOGBIN";
+
+static const size_t kMagicLen = 8;
+
+static void PutVarint(std::string& out, uint64_t v) {
+    char buf[10];
+    size_t n = 0;
+    while (v >= 0x80) {
+        buf[n++] = static_cast<char>(v | 0x80);
+        v >>= 7;
+    }
+    buf[n++] = static_cast<char>(v);
+    out.append(buf, n);
+}
+
+static uint64_t ZigZag(int64_t v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+static int64_t UnZigZag(uint64_t v) { return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1); }
+
+// 读取varint，数据不完整时返回false
+static bool GetVarint(const char*& cur, const char* end, uint64_t& v) {
+    v         = 0;
+    int shift = 0;
+    while (cur < end && shift < 64) {
+        uint8_t b = static_cast<uint8_t>(*cur++);
+        v |= static_cast<uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+        shift += 7;
+    }
+    return false;
+}
+
+void BinaryLogEncoder::reset(std::string& out) {
+    m_pointers.clear();
+    m_strings.clear();
+    m_table.clear();
+    m_sites.clear();
+    m_internArgs = 0;
+    m_lastTime   = 0;
+    m_lastThread = 0;
+    m_lastFiber  = 0;
+    m_startTime  = GetStartTimeNs();
+    out.append(kMagic, kMagicLen);
+    out.append(1, static_cast<char>(kVersion));
+    PutVarint(out, m_startTime);
+}
+
+uint32_t BinaryLogEncoder::internPointer(std::string& out, const char* str) {
+    if (!str) {
+        str = "";
+    }
+    auto it = m_pointers.find(str);
+    // 同一个指针的内容可能发生变化(非字面量)，需要再比较一次内容
+    if (it != m_pointers.end() && m_table[it->second] == str) {
+        return it->second;
+    }
+    uint32_t id     = internString(out, str, strlen(str));
+    m_pointers[str] = id;
+    return id;
+}
+
+uint32_t BinaryLogEncoder::internString(std::string& out, const char* str, size_t len) {
+    m_key.assign(str, len);
+    auto it = m_strings.find(m_key);
+    if (it != m_strings.end()) {
+        return it->second;
+    }
+    uint32_t id = m_table.size();
+    m_table.push_back(m_key);
+    m_strings[m_key] = id;
+
+    out.append(1, 'S');
+    PutVarint(out, id);
+    PutVarint(out, len);
+    out.append(str, len);
+    return id;
+}
+
+bool BinaryLogEncoder::internArg(std::string& out, const char* str, size_t len, uint32_t& id) {
+    if (len > kMaxInternArgLen) {
+        return false;
+    }
+    m_key.assign(str, len);
+    auto it = m_strings.find(m_key);
+    if (it != m_strings.end()) {
+        id = it->second;
+        return true;
+    }
+    if (m_internArgs >= kMaxInternArgs) {
+        return false;
+    }
+    ++m_internArgs;
+    id = internString(out, str, len);
+    return true;
+}
+
+uint32_t BinaryLogEncoder::internSite(std::string& out, LogLevel::Level level, const LogEvent& event) {
+    const std::string& name = event.getLogger()->getName();
+    uint32_t logger_id      = internString(out, name.data(), name.size());
+    uint32_t file_id        = internPointer(out, event.getFile());
+    const LogArgs& args     = event.getArgs();
+    // 格式串id为0表示没有格式串，其余为字符串表id+1
+    uint32_t fmt_id = args.empty() ? 0 : internPointer(out, args.getFormat()) + 1;
+    auto key = std::make_tuple(static_cast<uint32_t>(level), logger_id, file_id, static_cast<uint32_t>(event.getLine()),
+                               fmt_id);
+    auto it = m_sites.find(key);
+    if (it != m_sites.end()) {
+        return it->second;
+    }
+    uint32_t id = m_sites.size();
+    m_sites.emplace(key, id);
+
+    out.append(1, 'P');
+    PutVarint(out, id);
+    PutVarint(out, level);
+    PutVarint(out, logger_id);
+    PutVarint(out, file_id);
+    PutVarint(out, std::get<3>(key));
+    PutVarint(out, fmt_id);
+    return id;
+}
+
+void BinaryLogEncoder::encode(std::string& out, LogLevel::Level level, LogEvent::ptr event) {
+    uint32_t site            = internSite(out, level, *event);
+    const LogArgs& args      = event->getArgs();
+    const LogStream& content = event->getSS();
+
+    // 先把字符串参数放入字符串表('S'需要写在'E'之前)
+    const char* cur = args.data();
+    const char* end = cur + args.size();
+    int type        = 0;
+    uint64_t num    = 0;
+    const char* str = nullptr;
+    uint32_t len    = 0;
+    uint32_t id     = 0;
+    size_t count    = 0;
+    while (LogArgs::Next(cur, end, type, num, str, len)) {
+        if (type == LogArgs::STRING) {
+            internArg(out, str, len, id);
+        }
+        ++count;
+    }
+
+    uint64_t time   = event->getTimeNs();
+    uint64_t elapse = event->getElapseNs();
+    uint8_t flags   = 0;
+    if (event->getThreadId() != m_lastThread) {
+        flags |= EVENT_THREAD;
+    }
+    if (event->getFiberId() != m_lastFiber) {
+        flags |= EVENT_FIBER;
+    }
+    // 事件创建时的耗时就是 时间-启动时间，解码时可以还原
+    if (elapse != (time > m_startTime ? time - m_startTime : 0)) {
+        flags |= EVENT_ELAPSE;
+    }
+    if (content.size()) {
+        flags |= EVENT_CONTENT;
+    }
+    if (count) {
+        flags |= EVENT_ARGS;
+    }
+
+    out.append(1, 'E');
+    out.append(1, static_cast<char>(flags));
+    PutVarint(out, site);
+    PutVarint(out, ZigZag(static_cast<int64_t>(time - m_lastTime)));
+    m_lastTime = time;
+    if (flags & EVENT_THREAD) {
+        m_lastThread = event->getThreadId();
+        PutVarint(out, m_lastThread);
+    }
+    if (flags & EVENT_FIBER) {
+        m_lastFiber = event->getFiberId();
+        PutVarint(out, m_lastFiber);
+    }
+    if (flags & EVENT_ELAPSE) {
+        PutVarint(out, elapse);
+    }
+    if (flags & EVENT_CONTENT) {
+        PutVarint(out, content.size());
+        out.append(content.data(), content.size());
+    }
+    if (!count) {
+        return;
+    }
+
+    // 参数重新编码为更紧凑的格式：整数使用varint，浮点数尽量使用4字节，字符串尽量使用字符串表
+    PutVarint(out, count);
+    cur = args.data();
+    while (LogArgs::Next(cur, end, type, num, str, len)) {
+        if (type == LogArgs::STRING) {
+            if (internArg(out, str, len, id)) {
+                out.append(1, static_cast<char>(ARG_STRING_REF));
+                PutVarint(out, id);
+            } else {
+                out.append(1, static_cast<char>(type));
+                PutVarint(out, len);
+                out.append(str, len);
+            }
+        } else if (type == LogArgs::DOUBLE) {
+            double d;
+            memcpy(&d, &num, sizeof(d));
+            float f = static_cast<float>(d);
+            if (static_cast<double>(f) == d) {
+                out.append(1, static_cast<char>(ARG_FLOAT));
+                out.append(reinterpret_cast<const char*>(&f), sizeof(f));
+            } else {
+                out.append(1, static_cast<char>(type));
+                out.append(reinterpret_cast<const char*>(&num), sizeof(num));
+            }
+        } else {
+            out.append(1, static_cast<char>(type));
+            PutVarint(out, type == LogArgs::INT ? ZigZag(static_cast<int64_t>(num)) : num);
+        }
+    }
+}
+
+BinaryLogDecoder::BinaryLogDecoder() {}
+
+void BinaryLogDecoder::feed(const char* data, size_t len) {
+    // 丢弃已经解析过的数据
+    if (m_pos > 0) {
+        m_buffer.erase(0, m_pos);
+        m_pos = 0;
+    }
+    m_buffer.append(data, len);
+}
+
+Logger::ptr BinaryLogDecoder::getLogger(uint32_t id) {
+    auto it = m_loggers.find(id);
+    if (it != m_loggers.end()) {
+        return it->second;
+    }
+    Logger::ptr logger(new Logger(id < m_table.size() ? m_table[id] : "unknown"));
+    m_loggers[id] = logger;
+    return logger;
+}
+
+bool BinaryLogDecoder::readArgs(const char*& cur, const char* end, uint64_t count, std::string& args) {
+    for (uint64_t i = 0; i < count; ++i) {
+        if (cur >= end) {
+            return false;
+        }
+        char type    = *cur++;
+        uint64_t num = 0;
+        if (type == LogArgs::STRING || type == BinaryLogEncoder::ARG_STRING_REF) {
+            const char* str = nullptr;
+            uint64_t len    = 0;
+            if (type == LogArgs::STRING) {
+                if (!GetVarint(cur, end, len) || (uint64_t)(end - cur) < len) {
+                    return false;
+                }
+                str = cur;
+                cur += len;
+            } else {
+                uint64_t id = 0;
+                if (!GetVarint(cur, end, id)) {
+                    return false;
+                }
+                if (id >= m_table.size()) {
+                    m_error = true;
+                    return false;
+                }
+                str = m_table[id].data();
+                len = m_table[id].size();
+            }
+            uint32_t n = len;
+            args.append(1, static_cast<char>(LogArgs::STRING));
+            args.append(reinterpret_cast<const char*>(&n), sizeof(n));
+            args.append(str, len);
+            continue;
+        }
+        if (type == BinaryLogEncoder::ARG_FLOAT) {
+            float f;
+            if (end - cur < (ptrdiff_t)sizeof(f)) {
+                return false;
+            }
+            memcpy(&f, cur, sizeof(f));
+            cur += sizeof(f);
+            double d = f;
+            memcpy(&num, &d, sizeof(num));
+            type = LogArgs::DOUBLE;
+        } else if (type == LogArgs::DOUBLE) {
+            if (end - cur < (ptrdiff_t)sizeof(num)) {
+                return false;
+            }
+            memcpy(&num, cur, sizeof(num));
+            cur += sizeof(num);
+        } else {
+            if (!GetVarint(cur, end, num)) {
+                return false;
+            }
+            if (type == LogArgs::INT) {
+                num = static_cast<uint64_t>(UnZigZag(num));
+            }
+        }
+        args.append(1, type);
+        args.append(reinterpret_cast<const char*>(&num), sizeof(num));
+    }
+    return true;
+}
+
+LogEvent::ptr BinaryLogDecoder::readEventV2(const char*& cur, const char* end) {
+    uint64_t level = 0, logger_id = 0, file_id = 0, line = 0, time = 0, elapse = 0, thread_id = 0, fiber_id = 0,
+             fmt_id = 0, content_len = 0, count = 0;
+    if (!GetVarint(cur, end, level) || !GetVarint(cur, end, logger_id) || !GetVarint(cur, end, file_id) ||
+        !GetVarint(cur, end, line) || !GetVarint(cur, end, time) || !GetVarint(cur, end, elapse) ||
+        !GetVarint(cur, end, thread_id) || !GetVarint(cur, end, fiber_id) || !GetVarint(cur, end, fmt_id) ||
+        !GetVarint(cur, end, content_len) || (uint64_t)(end - cur) < content_len) {
+        return nullptr;
+    }
+    const char* content = cur;
+    cur += content_len;
+    // 还原为LogArgs的编码
+    std::string args;
+    if (!GetVarint(cur, end, count) || !readArgs(cur, end, count, args)) {
+        return nullptr;
+    }
+    if (file_id >= m_table.size() || logger_id >= m_table.size() || fmt_id > m_table.size()) {
+        m_error = true;
+        return nullptr;
+    }
+
+    m_lastTime += UnZigZag(time);
+    LogEvent::ptr event(new LogEvent(getLogger(logger_id), static_cast<LogLevel::Level>(level),
+                                     m_table[file_id].c_str(), line, 0, thread_id, fiber_id, 0));
+    if (m_version >= 2) {
+        event->setTimeNs(m_lastTime);
+        event->setElapseNs(elapse);
+    } else {
+        // 版本1: 时间精确到秒，耗时精确到毫秒
+        event->setTimeNs(m_lastTime * 1000000000ULL);
+        event->setElapseNs(elapse * 1000000ULL);
+    }
+    event->getSS().write(content, content_len);
+    if (fmt_id) {
+        event->getArgs().assign(m_table[fmt_id - 1].c_str(), args.data(), args.size());
+    }
+    return event;
+}
+
+LogEvent::ptr BinaryLogDecoder::readEvent(const char*& cur, const char* end) {
+    if (cur >= end) {
+        return nullptr;
+    }
+    uint8_t flags   = static_cast<uint8_t>(*cur++);
+    uint64_t site   = 0, time = 0, elapse = 0, content_len = 0, count = 0;
+    uint64_t thread = m_lastThread;
+    uint64_t fiber  = m_lastFiber;
+    if (!GetVarint(cur, end, site) || !GetVarint(cur, end, time)) {
+        return nullptr;
+    }
+    if (((flags & BinaryLogEncoder::EVENT_THREAD) && !GetVarint(cur, end, thread)) ||
+        ((flags & BinaryLogEncoder::EVENT_FIBER) && !GetVarint(cur, end, fiber)) ||
+        ((flags & BinaryLogEncoder::EVENT_ELAPSE) && !GetVarint(cur, end, elapse))) {
+        return nullptr;
+    }
+    const char* content = cur;
+    if (flags & BinaryLogEncoder::EVENT_CONTENT) {
+        if (!GetVarint(cur, end, content_len) || (uint64_t)(end - cur) < content_len) {
+            return nullptr;
+        }
+        content = cur;
+        cur += content_len;
+    }
+    std::string args;
+    if ((flags & BinaryLogEncoder::EVENT_ARGS) && (!GetVarint(cur, end, count) || !readArgs(cur, end, count, args))) {
+        return nullptr;
+    }
+    if (site >= m_sites.size()) {
+        m_error = true;
+        return nullptr;
+    }
+
+    const Site& s = m_sites[site];
+    m_lastTime += UnZigZag(time);
+    m_lastThread = thread;
+    m_lastFiber  = fiber;
+    LogEvent::ptr event(new LogEvent(getLogger(s.logger), static_cast<LogLevel::Level>(s.level),
+                                     m_table[s.file].c_str(), s.line, 0, thread, fiber, 0));
+    event->setTimeNs(m_lastTime);
+    if (!(flags & BinaryLogEncoder::EVENT_ELAPSE)) {
+        elapse = m_lastTime > m_startTime ? m_lastTime - m_startTime : 0;
+    }
+    event->setElapseNs(elapse);
+    event->getSS().write(content, content_len);
+    if (s.fmt) {
+        event->getArgs().assign(m_table[s.fmt - 1].c_str(), args.data(), args.size());
+    }
+    return event;
+}
+
+LogEvent::ptr BinaryLogDecoder::next() {
+    while (!m_error && m_pos < m_buffer.size()) {
+        const char* begin = m_buffer.data() + m_pos;
+        const char* cur   = begin;
+        const char* end   = m_buffer.data() + m_buffer.size();
+
+        // 文件头(同一个文件中可能有多次打开写入的文件头)
+        if (*cur == BinaryLogEncoder::kMagic[0]) {
+            if ((size_t)(end - cur) < kMagicLen + 1) {
+                return nullptr;
+            }
+            uint8_t version = static_cast<uint8_t>(cur[kMagicLen]);
+            if (memcmp(cur, BinaryLogEncoder::kMagic, kMagicLen) != 0 || version > BinaryLogEncoder::kVersion) {
+                m_error = true;
+                return nullptr;
+            }
+            cur += kMagicLen + 1;
+            // 版本3起文件头中记录进程启动时间
+            uint64_t start = 0;
+            if (version >= 3 && !GetVarint(cur, end, start)) {
+                return nullptr;
+            }
+            m_table.clear();
+            m_loggers.clear();
+            m_sites.clear();
+            m_lastTime   = 0;
+            m_lastThread = 0;
+            m_lastFiber  = 0;
+            m_startTime  = start;
+            m_version    = version;
+            m_started    = true;
+            m_pos += cur - begin;
+            continue;
+        }
+        if (!m_started) {
+            m_error = true;
+            return nullptr;
+        }
+
+        char tag = *cur++;
+        if (tag == 'S') {
+            uint64_t id = 0, len = 0;
+            if (!GetVarint(cur, end, id) || !GetVarint(cur, end, len) || (uint64_t)(end - cur) < len) {
+                return nullptr;
+            }
+            if (id != m_table.size()) {
+                m_error = true;
+                return nullptr;
+            }
+            m_table.push_back(std::string(cur, len));
+            m_pos += cur + len - begin;
+            continue;
+        }
+        if (tag == 'P' && m_version >= 3) {
+            uint64_t id = 0, level = 0, logger_id = 0, file_id = 0, line = 0, fmt_id = 0;
+            if (!GetVarint(cur, end, id) || !GetVarint(cur, end, level) || !GetVarint(cur, end, logger_id) ||
+                !GetVarint(cur, end, file_id) || !GetVarint(cur, end, line) || !GetVarint(cur, end, fmt_id)) {
+                return nullptr;
+            }
+            if (id != m_sites.size() || logger_id >= m_table.size() || file_id >= m_table.size() ||
+                fmt_id > m_table.size()) {
+                m_error = true;
+                return nullptr;
+            }
+            Site site;
+            site.level  = level;
+            site.logger = logger_id;
+            site.file   = file_id;
+            site.line   = line;
+            site.fmt    = fmt_id;
+            m_sites.push_back(site);
+            m_pos += cur - begin;
+            continue;
+        }
+        if (tag != 'E') {
+            m_error = true;
+            return nullptr;
+        }
+        LogEvent::ptr event = m_version >= 3 ? readEvent(cur, end) : readEventV2(cur, end);
+        if (!event) {
+            return nullptr;
+        }
+        m_pos += cur - begin;
+        return event;
+    }
+    return nullptr;
+}
+
+BinaryFileLogAppender::BinaryFileLogAppender(const std::string& filename) : m_filename(filename) {
+    // 默认ERROR及以上的日志立即写入
+    LogFlushPolicy policy;
+    policy.level = LogLevel::ERROR;
+    setFlushPolicy(policy);
+    reopen();
+}
+
+BinaryFileLogAppender::~BinaryFileLogAppender() { flush(); }
+
+void BinaryFileLogAppender::log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) {
+    if (level >= m_level) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_encoder.encode(m_buffer, level, event);
+        FlushAction action = flushAction(level);
+        if (m_buffer.size() >= 64 * 1024 || action != FLUSH_NONE) {
+            m_filestream.write(m_buffer.data(), m_buffer.size());
+            m_filestream.flush();
+            m_buffer.clear();
+            if (action == FLUSH_SYNC) {
+                SyncFile(m_filename);
+            }
+        }
+    }
+}
+
+void BinaryFileLogAppender::flush() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_filestream.write(m_buffer.data(), m_buffer.size());
+    m_filestream.flush();
+    m_buffer.clear();
+}
+
+bool BinaryFileLogAppender::reopen() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_filestream) {
+        m_filestream.write(m_buffer.data(), m_buffer.size());
+        m_filestream.close();
+    }
+    m_buffer.clear();
+    // 追加写入，每次打开都写入新的文件头
+    m_filestream.open(m_filename, std::ios::out | std::ios::app | std::ios::binary);
+    m_encoder.reset(m_buffer);
+    return !!m_filestream;
+}
+
+std::string BinaryFileLogAppender::toYamlString() {
+    YAML::Node node;
+    node["type"] = "BinaryFileLogAppender";
+    node["file"] = m_filename;
+    if (m_level != LogLevel::UNKNOWN) {
+        node["level"] = LogLevel::ToString(m_level);
+    }
+    flushPolicyToYaml(node);
+    std::stringstream ss;
+    ss << node;
+    return ss.str();
+}
+
+}  // namespace mylog
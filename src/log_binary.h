@@ -0,0 +1,147 @@
+#ifndef __MYLOG_LOG_BINARY_H__
+#define __MYLOG_LOG_BINARY_H__
+
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "log.h"
+
+namespace mylog {
+
+/**
+ * 二进制日志格式(自描述)：
+ *  文件头 : "MYLOGBIN" + 版本号(1字节) + 进程启动时间，每次打开文件都会重新写入文件头并清空字符串表
+ *  'S'    : 字符串表, [id][长度][内容]，文件名、日志名称、格式串、较短的字符串参数只在首次出现时写入一次
+ *  'P'    : 调用处, [id][级别][日志名称id][文件名id][行号][格式串id]，同一调用处只写入一次
+ *  'E'    : 日志事件, [标记][调用处id][时间差][线程id]?[协程id]?[耗时]?[内容长度 内容]?[参数个数 参数...]?
+ *           与上一条日志相同的线程id、协程id，等于 时间-启动时间 的耗时，空的内容、参数都不写入(见标记)
+ * 整数均使用varint编码，时间为与上一条日志的差值(zigzag)，参数为LogArgs记录的原始值，
+ * 其中可以用float精确表示的浮点数只写4字节，字符串参数写入字符串表的id
+ * 版本2起时间与耗时的单位为纳秒(版本1分别为秒和毫秒)，版本1、2的事件不使用调用处，解码器兼容所有版本
+ */
+class BinaryLogEncoder {
+   public:
+    static const char* kMagic;
+    static const uint8_t kVersion = 3;
+    // 事件标记
+    enum EventFlag { EVENT_THREAD = 1, EVENT_FIBER = 2, EVENT_ELAPSE = 4, EVENT_CONTENT = 8, EVENT_ARGS = 16 };
+    // 只在文件中使用的参数类型(其余与LogArgs::Type相同)
+    enum ArgType { ARG_FLOAT = 16, ARG_STRING_REF = 17 };
+    // 不超过该长度的字符串参数放入字符串表
+    static const size_t kMaxInternArgLen = 32;
+    // 字符串表中最多的字符串参数个数，超过后直接写入内容
+    static const size_t kMaxInternArgs = 4096;
+
+    // 写入文件头并清空字符串表
+    void reset(std::string& out);
+    // 将一条日志编码后追加到out
+    void encode(std::string& out, LogLevel::Level level, LogEvent::ptr event);
+
+   private:
+    // 按照指针查找字符串(文件名、格式串一般都是字面量)，内容不同时按内容查找
+    uint32_t internPointer(std::string& out, const char* str);
+    // 按照内容查找字符串
+    uint32_t internString(std::string& out, const char* str, size_t len);
+    // 查找字符串参数，不放入字符串表时返回false
+    bool internArg(std::string& out, const char* str, size_t len, uint32_t& id);
+    // 查找调用处
+    uint32_t internSite(std::string& out, LogLevel::Level level, const LogEvent& event);
+
+   private:
+    std::unordered_map<const char*, uint32_t> m_pointers;
+    std::unordered_map<std::string, uint32_t> m_strings;
+    std::vector<std::string> m_table;
+    // 按内容查找时复用的缓冲区
+    std::string m_key;
+    // [级别, 日志名称id, 文件名id, 行号, 格式串id] -> 调用处id
+    std::map<std::tuple<uint32_t, uint32_t, uint32_t, uint32_t, uint32_t>, uint32_t> m_sites;
+    size_t m_internArgs   = 0;
+    uint64_t m_lastTime   = 0;
+    uint64_t m_startTime  = 0;
+    uint32_t m_lastThread = 0;
+    uint32_t m_lastFiber  = 0;
+};
+
+// 二进制日志的解码器，可以分多次输入数据
+class BinaryLogDecoder {
+   public:
+    BinaryLogDecoder();
+    // 输入新的数据
+    void feed(const char* data, size_t len);
+    // 解析下一条日志，数据不完整时返回nullptr
+    LogEvent::ptr next();
+    // 数据格式错误
+    bool isError() const { return m_error; }
+    // 是否还有未解析的数据
+    bool hasPending() const { return m_pos < m_buffer.size(); }
+
+   private:
+    // 获取日志名称对应的Logger(只用于格式化, 不注册到LoggerManager)
+    Logger::ptr getLogger(uint32_t id);
+    // 读取count个参数并还原为LogArgs的编码，数据不完整时返回false
+    bool readArgs(const char*& cur, const char* end, uint64_t count, std::string& args);
+    // 解析版本1、2的事件
+    LogEvent::ptr readEventV2(const char*& cur, const char* end);
+    // 解析版本3的事件
+    LogEvent::ptr readEvent(const char*& cur, const char* end);
+
+    // 调用处
+    struct Site {
+        uint32_t level;
+        uint32_t logger;
+        uint32_t file;
+        uint32_t line;
+        uint32_t fmt;
+    };
+
+   private:
+    std::string m_buffer;
+    size_t m_pos = 0;
+    bool m_error = false;
+    // 是否已经读到文件头
+    bool m_started = false;
+    // deque扩容时不会移动已有元素，事件中的文件名、格式串指针保持有效
+    std::deque<std::string> m_table;
+    std::unordered_map<uint32_t, Logger::ptr> m_loggers;
+    std::vector<Site> m_sites;
+    uint64_t m_lastTime   = 0;
+    uint64_t m_startTime  = 0;
+    uint32_t m_lastThread = 0;
+    uint32_t m_lastFiber  = 0;
+    // 当前文件头的版本号
+    uint8_t m_version = BinaryLogEncoder::kVersion;
+};
+
+// 以二进制格式输出到文件的Appender，不使用formatter
+// 日志先写入内存缓冲区，缓冲区满、ERROR以上级别、flush或者析构时写入文件
+class BinaryFileLogAppender : public LogAppender {
+   public:
+    typedef std::shared_ptr<BinaryFileLogAppender> ptr;
+    BinaryFileLogAppender(const std::string& filename);
+    ~BinaryFileLogAppender();
+    void log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr event) override;
+    std::string toYamlString() override;
+    // 文件的重复打开, 打开成功返回true
+    bool reopen();
+    void flush();
+
+   private:
+    void flushWrite() override { flush(); }
+
+   private:
+    std::string m_filename;
+    std::ofstream m_filestream;
+    std::mutex m_mutex;
+    BinaryLogEncoder m_encoder;
+    std::string m_buffer;
+};
+
+}  // namespace mylog
+
+#endif
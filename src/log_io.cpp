@@ -0,0 +1,434 @@
+#include "log_io.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <linux/io_uring.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+
+namespace mylog {
+
+// 没有使用liburing，直接调用系统调用
+static int IoUringSetup(unsigned entries, struct io_uring_params* params) {
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int IoUringEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+static int IoUringRegister(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+LogIoService* LogIoService::GetInstance() {
+    static LogIoService* s_instance = new LogIoService;
+    return s_instance;
+}
+
+LogIoService::LogIoService(bool use_uring) {
+    m_buffers = (char*)aligned_alloc(4096, kBufferSize * kBufferCount);
+    for (size_t i = 0; i < kBufferCount; ++i) {
+        m_freeBuffers.push_back(kBufferCount - 1 - i);
+    }
+    for (size_t i = 0; i < kMaxFiles; ++i) {
+        m_files[i] = -1;
+    }
+    if (use_uring) {
+        setupUring();
+    }
+    m_thread = std::thread(&LogIoService::run, this);
+}
+
+LogIoService::~LogIoService() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cond.notify_one();
+    // 后台线程写完所有请求后退出
+    m_thread.join();
+    closeUring();
+    free(m_buffers);
+}
+
+bool LogIoService::setupUring() {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    m_ringFd = IoUringSetup(kBufferCount * 2, &params);
+    if (m_ringFd < 0) {
+        return false;
+    }
+    m_sqEntries  = params.sq_entries;
+    m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+    }
+    m_sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd,
+                    IORING_OFF_SQ_RING);
+    if (m_sqRing == MAP_FAILED) {
+        m_sqRing = nullptr;
+        closeUring();
+        return false;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        m_cqRing = m_sqRing;
+    } else {
+        m_cqRing = mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd,
+                        IORING_OFF_CQ_RING);
+        if (m_cqRing == MAP_FAILED) {
+            m_cqRing = nullptr;
+            closeUring();
+            return false;
+        }
+    }
+    m_sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    m_sqes     = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd,
+                      IORING_OFF_SQES);
+    if (m_sqes == MAP_FAILED) {
+        m_sqes = nullptr;
+        closeUring();
+        return false;
+    }
+    char* sq  = (char*)m_sqRing;
+    char* cq  = (char*)m_cqRing;
+    m_sqHead  = (unsigned*)(sq + params.sq_off.head);
+    m_sqTail  = (unsigned*)(sq + params.sq_off.tail);
+    m_sqMask  = (unsigned*)(sq + params.sq_off.ring_mask);
+    m_sqArray = (unsigned*)(sq + params.sq_off.array);
+    m_cqHead  = (unsigned*)(cq + params.cq_off.head);
+    m_cqTail  = (unsigned*)(cq + params.cq_off.tail);
+    m_cqMask  = (unsigned*)(cq + params.cq_off.ring_mask);
+    m_cqes    = cq + params.cq_off.cqes;
+
+    // 注册缓冲区，内核不需要每次写入都重新映射用户内存(超过RLIMIT_MEMLOCK时失败，使用普通写入)
+    struct iovec iovs[kBufferCount];
+    for (size_t i = 0; i < kBufferCount; ++i) {
+        iovs[i].iov_base = m_buffers + i * kBufferSize;
+        iovs[i].iov_len  = kBufferSize;
+    }
+    m_fixedBuffers = IoUringRegister(m_ringFd, IORING_REGISTER_BUFFERS, iovs, kBufferCount) == 0;
+    // 注册空的固定文件表，写入新的文件时再更新
+    m_fixedFiles = IoUringRegister(m_ringFd, IORING_REGISTER_FILES, m_files, kMaxFiles) == 0;
+    return true;
+}
+
+void LogIoService::closeUring() {
+    if (m_sqes) {
+        munmap(m_sqes, m_sqesSize);
+        m_sqes = nullptr;
+    }
+    if (m_cqRing && m_cqRing != m_sqRing) {
+        munmap(m_cqRing, m_cqRingSize);
+    }
+    m_cqRing = nullptr;
+    if (m_sqRing) {
+        munmap(m_sqRing, m_sqRingSize);
+        m_sqRing = nullptr;
+    }
+    if (m_ringFd >= 0) {
+        ::close(m_ringFd);
+        m_ringFd = -1;
+    }
+    m_fixedBuffers = false;
+    m_fixedFiles   = false;
+}
+
+uint64_t LogIoService::write(int fd, const char* data, size_t len) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (len > 0) {
+        if (m_freeBuffers.empty()) {
+            // 背压: 等待前面的写入完成后释放缓冲区
+            ++m_stats.waits;
+            m_cond.notify_one();
+            m_doneCond.wait(lock, [this]() { return !m_freeBuffers.empty(); });
+            continue;
+        }
+        Request req;
+        req.fd     = fd;
+        req.file   = -1;
+        req.buffer = m_freeBuffers.back();
+        req.offset = 0;
+        req.len    = std::min(len, kBufferSize);
+        // 每个缓冲区单独的序号，没有写完的部分不会被当作已经完成
+        req.seq = ++m_seq;
+        m_freeBuffers.pop_back();
+        memcpy(m_buffers + (size_t)req.buffer * kBufferSize, data, req.len);
+        m_pending.push_back(req);
+        data += req.len;
+        len -= req.len;
+    }
+    m_cond.notify_one();
+    return m_seq;
+}
+
+void LogIoService::wait(uint64_t seq) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCond.wait(lock, [this, seq]() { return m_doneSeq >= seq; });
+}
+
+void LogIoService::release(int fd) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // 之前的请求写完后，不会再有该fd的请求
+    uint64_t seq = m_seq;
+    m_doneCond.wait(lock, [this, seq]() { return m_doneSeq >= seq; });
+    for (size_t i = 0; i < kMaxFiles; ++i) {
+        if (m_files[i] == fd) {
+            struct io_uring_files_update update;
+            memset(&update, 0, sizeof(update));
+            int removed   = -1;
+            update.offset = i;
+            update.fds    = (uint64_t)(uintptr_t)&removed;
+            IoUringRegister(m_ringFd, IORING_REGISTER_FILES_UPDATE, &update, 1);
+            m_files[i] = -1;
+        }
+    }
+}
+
+LogIoService::Stats LogIoService::getStats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+int LogIoService::fileIndex(int fd) {
+    if (!m_fixedFiles) {
+        return -1;
+    }
+    int empty = -1;
+    for (size_t i = 0; i < kMaxFiles; ++i) {
+        if (m_files[i] == fd) {
+            return i;
+        }
+        if (empty < 0 && m_files[i] < 0) {
+            empty = i;
+        }
+    }
+    if (empty < 0) {
+        return -1;
+    }
+    struct io_uring_files_update update;
+    memset(&update, 0, sizeof(update));
+    update.offset = empty;
+    update.fds    = (uint64_t)(uintptr_t)&fd;
+    if (IoUringRegister(m_ringFd, IORING_REGISTER_FILES_UPDATE, &update, 1) != 1) {
+        return -1;
+    }
+    m_files[empty] = fd;
+    return empty;
+}
+
+void LogIoService::run() {
+    std::vector<Request> batch;
+    std::vector<Request> retry;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cond.wait(lock, [this]() { return m_stopping || !m_pending.empty(); });
+        if (m_pending.empty()) {
+            break;
+        }
+        // 取出所有等待写入的请求作为一批(最多kBufferCount个)
+        batch.clear();
+        while (!m_pending.empty()) {
+            Request req = m_pending.front();
+            m_pending.pop_front();
+            if (m_ringFd >= 0) {
+                req.file = fileIndex(req.fd);
+            }
+            batch.push_back(req);
+        }
+        lock.unlock();
+
+        Stats stats;
+        retry.clear();
+        if (m_ringFd >= 0) {
+            submitUring(batch, retry, stats);
+        } else {
+            submitWritev(batch, retry, stats);
+        }
+
+        lock.lock();
+        // 没有写完的请求放回队首，保持同一个文件的写入顺序
+        for (auto it = retry.rbegin(); it != retry.rend(); ++it) {
+            m_pending.push_front(*it);
+        }
+        for (auto& i : batch) {
+            bool pending = std::any_of(retry.begin(), retry.end(),
+                                       [&i](const Request& r) { return r.buffer == i.buffer; });
+            if (!pending) {
+                m_freeBuffers.push_back(i.buffer);
+            }
+        }
+        m_doneSeq = m_pending.empty() ? m_seq : m_pending.front().seq - 1;
+        m_stats.syscalls += stats.syscalls;
+        m_stats.batches += stats.batches;
+        m_stats.writes += stats.writes;
+        m_stats.bytes += stats.bytes;
+        m_doneCond.notify_all();
+    }
+}
+
+void LogIoService::submitUring(std::vector<Request>& batch, std::vector<Request>& retry, Stats& stats) {
+    // 同一个文件的请求放在一起，文件内保持原来的顺序
+    std::stable_sort(batch.begin(), batch.end(), [](const Request& a, const Request& b) { return a.fd < b.fd; });
+    struct io_uring_sqe* sqes = (struct io_uring_sqe*)m_sqes;
+    struct io_uring_cqe* cqes = (struct io_uring_cqe*)m_cqes;
+    size_t n                  = std::min<size_t>(batch.size(), m_sqEntries);
+    // 超出提交队列的部分留到下一批
+    for (size_t i = n; i < batch.size(); ++i) {
+        retry.push_back(batch[i]);
+    }
+
+    unsigned tail = *m_sqTail;
+    for (size_t i = 0; i < n; ++i) {
+        const Request& req       = batch[i];
+        unsigned index           = tail & *m_sqMask;
+        struct io_uring_sqe* sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = m_fixedBuffers ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        if (req.file >= 0) {
+            sqe->fd = req.file;
+            sqe->flags |= IOSQE_FIXED_FILE;
+        } else {
+            sqe->fd = req.fd;
+        }
+        sqe->addr = (uint64_t)(uintptr_t)(m_buffers + (size_t)req.buffer * kBufferSize + req.offset);
+        sqe->len  = req.len;
+        // 使用(O_APPEND)文件的当前位置
+        sqe->off = (uint64_t)-1;
+        if (m_fixedBuffers) {
+            sqe->buf_index = req.buffer;
+        }
+        // 同一个文件的写入按顺序执行，前一个失败或者部分写入时后面的被取消
+        if (i + 1 < n && batch[i + 1].fd == req.fd) {
+            sqe->flags |= IOSQE_IO_LINK;
+        }
+        sqe->user_data   = i;
+        m_sqArray[index] = index;
+        ++tail;
+    }
+    __atomic_store_n(m_sqTail, tail, __ATOMIC_RELEASE);
+
+    // 一次系统调用提交整批并等待全部完成
+    // 出错时没有提交的是最后submit个请求，已经提交的请求要等到完成后才能关闭io_uring，否则会重复写入
+    const int kPending = INT_MIN;
+    std::vector<int> results(n, kPending);
+    unsigned submit    = n;
+    unsigned completed = 0;
+    bool failed        = false;
+    while (completed < n - (failed ? submit : 0)) {
+        int rt = IoUringEnter(m_ringFd, failed ? 0 : submit, n - completed - (failed ? submit : 0),
+                              IORING_ENTER_GETEVENTS);
+        ++stats.syscalls;
+        if (rt < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                continue;
+            }
+            if (failed) {
+                std::cout << "LogIoService io_uring_enter wait error: " << strerror(errno) << "\n";
+                break;
+            }
+            // 没有提交的请求在下一批改用writev写入
+            std::cout << "LogIoService io_uring_enter error: " << strerror(errno) << ", fallback to writev\n";
+            failed = true;
+            continue;
+        }
+        if (!failed) {
+            submit -= std::min<unsigned>(submit, rt);
+        }
+        unsigned head = *m_cqHead;
+        unsigned cq   = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+        for (; head != cq; ++head) {
+            struct io_uring_cqe* cqe = &cqes[head & *m_cqMask];
+            results[cqe->user_data]  = cqe->res;
+            ++completed;
+        }
+        __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+    }
+    if (failed) {
+        closeUring();
+    }
+    ++stats.batches;
+
+    for (size_t i = 0; i < n; ++i) {
+        Request& req = batch[i];
+        int res      = results[i];
+        if (res == kPending) {
+            if (i >= n - submit) {
+                // 没有提交
+                retry.push_back(req);
+            } else {
+                // 已经提交但是拿不到结果，可能已经写入，不再重试
+                std::cout << "LogIoService write fd = " << req.fd << " result unknown\n";
+                ++stats.writes;
+            }
+        } else if (res >= 0) {
+            stats.bytes += res;
+            if ((uint32_t)res < req.len) {
+                req.offset += res;
+                req.len -= res;
+                retry.push_back(req);
+            } else {
+                ++stats.writes;
+            }
+        } else if (res == -ECANCELED || res == -EINTR || res == -EAGAIN) {
+            retry.push_back(req);
+        } else {
+            std::cout << "LogIoService write fd = " << req.fd << " error: " << strerror(-res) << "\n";
+            ++stats.writes;
+        }
+    }
+    std::sort(retry.begin(), retry.end(), [](const Request& a, const Request& b) { return a.seq < b.seq; });
+}
+
+void LogIoService::submitWritev(std::vector<Request>& batch, std::vector<Request>& retry, Stats& stats) {
+    std::stable_sort(batch.begin(), batch.end(), [](const Request& a, const Request& b) { return a.fd < b.fd; });
+    struct iovec iovs[IOV_MAX];
+    size_t begin = 0;
+    while (begin < batch.size()) {
+        // 同一个文件的请求一次writev
+        size_t end = begin;
+        int count  = 0;
+        while (end < batch.size() && batch[end].fd == batch[begin].fd && count < IOV_MAX) {
+            iovs[count].iov_base = m_buffers + (size_t)batch[end].buffer * kBufferSize + batch[end].offset;
+            iovs[count].iov_len  = batch[end].len;
+            ++count;
+            ++end;
+        }
+        struct iovec* iov = iovs;
+        while (count > 0) {
+            ssize_t rt = ::writev(batch[begin].fd, iov, count);
+            ++stats.syscalls;
+            if (rt < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                std::cout << "LogIoService writev fd = " << batch[begin].fd << " error: " << strerror(errno)
+                          << "\n";
+                break;
+            }
+            stats.bytes += rt;
+            // 跳过已经写完的部分
+            while (count > 0 && (size_t)rt >= iov->iov_len) {
+                rt -= iov->iov_len;
+                ++iov;
+                --count;
+            }
+            if (count > 0) {
+                iov->iov_base = (char*)iov->iov_base + rt;
+                iov->iov_len -= rt;
+            }
+        }
+        stats.writes += end - begin;
+        begin = end;
+    }
+    ++stats.batches;
+}
+
+}  // namespace mylog
@@ -0,0 +1,137 @@
+#ifndef __MYLOG_LOG_IO_H__
+#define __MYLOG_LOG_IO_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mylog {
+
+/**
+ * 多个文件共用的批量写入服务
+ * 调用方把数据复制到服务内部的缓冲区后立即返回，后台线程把所有文件等待写入的数据合并为一批:
+ *  - 支持io_uring时一批只需要一次io_uring_enter(提交并等待完成)，
+ *    缓冲区预先注册(IORING_REGISTER_BUFFERS)，文件描述符注册为固定文件(IORING_REGISTER_FILES)
+ *  - 不支持时(内核版本、seccomp等)每个文件一次writev
+ * 同一个文件的写入保持顺序(同一批内用IOSQE_IO_LINK串联)，部分写入的剩余部分在下一批继续写
+ * 缓冲区用完时write阻塞，直到前面的写入完成(背压)
+ * 注意: 关闭文件描述符之前必须调用release，否则注册的固定文件仍然指向旧的文件
+ */
+class LogIoService {
+   public:
+    // 每个缓冲区的大小，超过的写入拆分为多个缓冲区
+    static constexpr size_t kBufferSize = 256 * 1024;
+    // 缓冲区数量，也是一批最多的写入数
+    static constexpr size_t kBufferCount = 32;
+    // 固定文件表的大小
+    static constexpr size_t kMaxFiles = 64;
+
+    // 统计信息
+    struct Stats {
+        // 写入系统调用次数(io_uring_enter或者writev)
+        uint64_t syscalls = 0;
+        // 批次数
+        uint64_t batches = 0;
+        // 完成的写入请求数(每个缓冲区一个)
+        uint64_t writes = 0;
+        // 写入的字节数
+        uint64_t bytes = 0;
+        // 等待空闲缓冲区的次数
+        uint64_t waits = 0;
+    };
+
+    // 进程内共用的实例，不会析构(进程退出时析构的Appender仍然可以使用)
+    static LogIoService* GetInstance();
+
+    // use_uring为false时总是使用writev
+    LogIoService(bool use_uring = true);
+    ~LogIoService();
+    LogIoService(const LogIoService&) = delete;
+    LogIoService& operator=(const LogIoService&) = delete;
+
+    // 写入fd，数据复制到内部缓冲区后返回写入序号
+    uint64_t write(int fd, const char* data, size_t len);
+    // 等待序号及之前的写入全部完成
+    void wait(uint64_t seq);
+    // 等待fd的写入完成，并取消fd的固定文件注册(关闭fd之前调用)
+    void release(int fd);
+    // 是否使用io_uring
+    bool isUring() const { return m_ringFd >= 0; }
+    Stats getStats();
+
+   private:
+    // 一次写入请求(占用一个缓冲区)
+    struct Request {
+        int fd;
+        // 固定文件表中的位置，-1表示没有注册
+        int file;
+        uint32_t buffer;
+        uint32_t offset;
+        uint32_t len;
+        uint64_t seq;
+    };
+
+    // 后台线程
+    void run();
+    // 创建io_uring，失败时返回false
+    bool setupUring();
+    void closeUring();
+    // 返回fd在固定文件表中的位置，没有注册时返回-1(调用方持有m_mutex)
+    int fileIndex(int fd);
+    // 写入一批请求，没有写完的请求(剩余部分)放入retry
+    void submitUring(std::vector<Request>& batch, std::vector<Request>& retry, Stats& stats);
+    void submitWritev(std::vector<Request>& batch, std::vector<Request>& retry, Stats& stats);
+
+   private:
+    std::mutex m_mutex;
+    // 唤醒后台线程
+    std::condition_variable m_cond;
+    // 通知等待缓冲区、等待完成的调用方
+    std::condition_variable m_doneCond;
+    // 等待写入的请求(按照序号排列)
+    std::deque<Request> m_pending;
+    // 空闲的缓冲区
+    std::vector<uint32_t> m_freeBuffers;
+    char* m_buffers = nullptr;
+    // 已分配的最大序号
+    uint64_t m_seq = 0;
+    // 该序号及之前的写入已经完成
+    uint64_t m_doneSeq = 0;
+    bool m_stopping    = false;
+    Stats m_stats;
+    // 固定文件表，-1表示空位
+    int m_files[kMaxFiles];
+
+    // io_uring
+    int m_ringFd         = -1;
+    bool m_fixedBuffers  = false;
+    bool m_fixedFiles    = false;
+    void* m_sqRing       = nullptr;
+    size_t m_sqRingSize  = 0;
+    void* m_cqRing       = nullptr;
+    size_t m_cqRingSize  = 0;
+    void* m_sqes         = nullptr;
+    size_t m_sqesSize    = 0;
+    unsigned m_sqEntries = 0;
+    unsigned* m_sqHead   = nullptr;
+    unsigned* m_sqTail   = nullptr;
+    unsigned* m_sqMask   = nullptr;
+    unsigned* m_sqArray  = nullptr;
+    unsigned* m_cqHead   = nullptr;
+    unsigned* m_cqTail   = nullptr;
+    unsigned* m_cqMask   = nullptr;
+    void* m_cqes         = nullptr;
+
+    std::thread m_thread;
+};
+
+}  // namespace mylog
+
+#endif
@@ -0,0 +1,248 @@
+#ifndef __MYLOG_LOG_STATIC_H__
+#define __MYLOG_LOG_STATIC_H__
+
+#include <stddef.h>
+
+#include <string>
+#include <utility>
+
+#include "log.h"
+
+// 定义一个编译期解析的日志格式 name，例如:
+//   MYLOG_STATIC_FORMATTER(MyFormatter, "%d%T[%p]%T%m%n");
+//   logger->setFormatter(MyFormatter::Create());
+#define MYLOG_STATIC_FORMATTER(name, pattern)               \
+    static constexpr char name##_mylog_pattern[] = pattern; \
+    typedef mylog::StaticFormatter<name##_mylog_pattern> name
+
+namespace mylog {
+
+// 编译期解析结果中的一条指令，含义与LogFormatter::Op相同
+struct StaticOp {
+    int code      = LogFormatter::OP_LITERAL;
+    size_t offset = 0;
+    size_t len    = 0;
+};
+
+// 编译期解析的结果，N为格式串长度(每条指令、每个文本字符都至少消耗格式串中的一个字符)
+template <size_t N>
+struct StaticProgram {
+    StaticOp ops[N + 1]  = {};
+    size_t count         = 0;
+    char literals[N + 1] = {};
+    size_t literalSize   = 0;
+    // 日期格式，每个以'\0'结尾
+    char dates[2 * N + 2] = {};
+    size_t dateSize       = 0;
+    bool error            = false;
+
+    constexpr void literal(char c) {
+        if (count == 0 || ops[count - 1].code != LogFormatter::OP_LITERAL) {
+            ops[count].code   = LogFormatter::OP_LITERAL;
+            ops[count].offset = literalSize;
+            ops[count].len    = 0;
+            ++count;
+        }
+        literals[literalSize++] = c;
+        ++ops[count - 1].len;
+    }
+};
+
+constexpr size_t StaticStrLen(const char* str) {
+    size_t len = 0;
+    while (str[len]) {
+        ++len;
+    }
+    return len;
+}
+
+constexpr bool StaticIsAlpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+
+// 与LogFormatter::init/compile完全相同的解析规则，解析失败时设置error
+template <size_t N>
+constexpr StaticProgram<N> StaticCompile(const char* p) {
+    StaticProgram<N> prog;
+    // 尚未输出的普通文本在格式串中的位置，'%%'只取一个'%'，所以逐个记录
+    size_t pending[N + 1] = {};
+    size_t pendingSize    = 0;
+
+    for (size_t i = 0; i < N; ++i) {
+        if (p[i] != '%') {
+            pending[pendingSize++] = i;
+            continue;
+        }
+        if (i + 1 < N && p[i + 1] == '%') {
+            pending[pendingSize++] = i;
+            continue;
+        }
+
+        size_t n            = i + 1;
+        int format_status   = 0;
+        size_t key_begin    = i + 1;
+        size_t key_len      = 0;
+        size_t format_begin = 0;
+        size_t fmt_begin    = 0;
+        size_t fmt_len      = 0;
+        while (n < N) {
+            if (format_status == 0 && !StaticIsAlpha(p[n]) && p[n] != '{' && p[n] != '}') {
+                break;
+            }
+            if (format_status == 0 && p[n] == '{') {
+                key_len       = n - key_begin;
+                format_status = 1;
+                format_begin  = n;
+                ++n;
+                continue;
+            }
+            if (format_status == 1 && p[n] == '}') {
+                fmt_begin     = format_begin + 1;
+                fmt_len       = n - fmt_begin;
+                format_status = 2;
+                ++n;
+                break;
+            }
+            ++n;
+        }
+        if (format_status == 1) {
+            prog.error = true;
+            return prog;
+        }
+        if (format_status == 0) {
+            key_len = n - key_begin;
+        }
+
+        for (size_t k = 0; k < pendingSize; ++k) {
+            prog.literal(p[pending[k]]);
+        }
+        pendingSize = 0;
+
+        int code = -1;
+        if (key_len == 1) {
+            switch (p[key_begin]) {
+                case 'T':
+                    prog.literal('\t');
+                    break;
+                case 'n':
+                    prog.literal('\n');
+                    break;
+                case 'm':
+                    code = LogFormatter::OP_MESSAGE;
+                    break;
+                case 'p':
+                    code = LogFormatter::OP_LEVEL;
+                    break;
+                case 'r':
+                    code = LogFormatter::OP_ELAPSE;
+                    break;
+                case 'c':
+                    code = LogFormatter::OP_NAME;
+                    break;
+                case 't':
+                    code = LogFormatter::OP_THREAD_ID;
+                    break;
+                case 'F':
+                    code = LogFormatter::OP_FIBER_ID;
+                    break;
+                case 'd':
+                    code = LogFormatter::OP_DATETIME;
+                    break;
+                case 'f':
+                    code = LogFormatter::OP_FILENAME;
+                    break;
+                case 'l':
+                    code = LogFormatter::OP_LINE;
+                    break;
+                case 'N':
+                    code = LogFormatter::OP_THREAD_NAME;
+                    break;
+                default:
+                    prog.error = true;
+                    return prog;
+            }
+        } else {
+            prog.error = true;
+            return prog;
+        }
+        if (code >= 0) {
+            StaticOp& op = prog.ops[prog.count++];
+            op.code      = code;
+            if (code == LogFormatter::OP_DATETIME && fmt_len) {
+                // len为0时使用默认日期格式
+                op.offset = prog.dateSize;
+                op.len    = fmt_len;
+                for (size_t k = 0; k < fmt_len; ++k) {
+                    prog.dates[prog.dateSize++] = p[fmt_begin + k];
+                }
+                prog.dates[prog.dateSize++] = '\0';
+            } else if (code == LogFormatter::OP_ELAPSE) {
+                op.offset = LogFormatter::ElapseDivisor(p + fmt_begin, fmt_len);
+            }
+        }
+        i = n - 1;
+    }
+    for (size_t k = 0; k < pendingSize; ++k) {
+        prog.literal(p[pending[k]]);
+    }
+    return prog;
+}
+
+/**
+ * 编译期解析的日志格式
+ * 格式串在编译期解析为指令序列，每条指令展开为一段内联代码，运行时没有解析、没有虚函数调用
+ * 输出与相同格式的LogFormatter完全一致；YAML等运行期配置的格式仍然使用LogFormatter
+ * Pattern必须是具有静态存储期的constexpr字符数组，可以使用MYLOG_STATIC_FORMATTER定义
+ */
+template <const char* Pattern>
+class StaticFormatter {
+   public:
+    static constexpr size_t kLength                  = StaticStrLen(Pattern);
+    static constexpr StaticProgram<kLength> kProgram = StaticCompile<kLength>(Pattern);
+    static_assert(!kProgram.error, "invalid log formatter pattern");
+
+    // 将格式化结果追加到out
+    static void format(std::string& out, LogLevel::Level level, const LogEvent& event) {
+        formatImpl(out, level, event, std::make_index_sequence<kProgram.count>());
+    }
+
+    // 创建使用该格式的LogFormatter，可以直接设置给Logger或者Appender
+    static LogFormatter::ptr Create() { return LogFormatter::ptr(new LogFormatter(Pattern, &format)); }
+
+   private:
+    template <size_t... I>
+    static void formatImpl(std::string& out, LogLevel::Level level, const LogEvent& event, std::index_sequence<I...>) {
+        (formatOp<I>(out, level, event), ...);
+    }
+
+    template <size_t I>
+    static void formatOp(std::string& out, LogLevel::Level level, const LogEvent& event) {
+        constexpr StaticOp op = kProgram.ops[I];
+        if constexpr (op.code == LogFormatter::OP_LITERAL) {
+            out.append(kProgram.literals + op.offset, op.len);
+        } else if constexpr (op.code == LogFormatter::OP_MESSAGE) {
+            event.appendContent(out);
+        } else if constexpr (op.code == LogFormatter::OP_LEVEL) {
+            out.append(LogLevel::ToString(level));
+        } else if constexpr (op.code == LogFormatter::OP_ELAPSE) {
+            LogFormatter::AppendUInt(out, event.getElapseNs() / op.offset);
+        } else if constexpr (op.code == LogFormatter::OP_NAME) {
+            out.append(event.getLogger()->getName());
+        } else if constexpr (op.code == LogFormatter::OP_THREAD_ID) {
+            LogFormatter::AppendUInt(out, event.getThreadId());
+        } else if constexpr (op.code == LogFormatter::OP_FIBER_ID) {
+            LogFormatter::AppendUInt(out, event.getFiberId());
+        } else if constexpr (op.code == LogFormatter::OP_DATETIME) {
+            LogFormatter::AppendDateTime(out, op.len ? kProgram.dates + op.offset : "%Y-%m-%d %H:%M:%S",
+                                         event.getTime(), event.getNsec());
+        } else if constexpr (op.code == LogFormatter::OP_FILENAME) {
+            out.append(event.getFile() ? event.getFile() : "");
+        } else if constexpr (op.code == LogFormatter::OP_LINE) {
+            LogFormatter::AppendInt(out, event.getLine());
+        } else if constexpr (op.code == LogFormatter::OP_THREAD_NAME) {
+            out.append(event.getThreadName());
+        }
+    }
+};
+
+}  // namespace mylog
+
+#endif
@@ -0,0 +1,111 @@
+#include "rcu.h"
+
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <thread>
+
+namespace mylog {
+
+// 全局纪元，从1开始(0表示不在读取)
+static std::atomic<uint64_t> s_epoch{1};
+// 所有线程的记录，只增加不删除
+static std::atomic<RcuReader*> s_readers{nullptr};
+static thread_local RcuReader* t_reader = nullptr;
+
+// 写入方用membarrier让所有读取线程执行一次内存屏障，读取方登记时就不需要屏障指令了
+static bool RegisterMembarrier() {
+    int cmds = syscall(__NR_membarrier, MEMBARRIER_CMD_QUERY, 0);
+    return cmds > 0 && (cmds & MEMBARRIER_CMD_PRIVATE_EXPEDITED) &&
+           syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0) == 0;
+}
+static const bool s_membarrier = RegisterMembarrier();
+
+// 线程退出时归还记录
+struct RcuReaderReleaser {
+    ~RcuReaderReleaser() { RcuReader::Release(); }
+};
+
+// fork后子进程中只有调用fork的线程，其他线程的记录不会再退出读取
+struct RcuForkIniter {
+    RcuForkIniter() { pthread_atfork(nullptr, nullptr, RcuReader::ResetAfterFork); }
+};
+static RcuForkIniter s_rcuForkIniter;
+
+RcuReader* RcuReader::Enter() {
+    RcuReader* reader = t_reader;
+    if (MYLOG_UNLIKELY(!reader)) {
+        reader = Acquire();
+    }
+    if (reader->m_depth++ == 0) {
+        // 登记之后再读取值，写入方要么看到登记而等待，要么在登记之前已经替换完成
+        uint64_t epoch = s_epoch.load(std::memory_order_acquire);
+        if (MYLOG_LIKELY(s_membarrier)) {
+            reader->m_epoch.store(epoch, std::memory_order_relaxed);
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+        } else {
+            reader->m_epoch.store(epoch);
+        }
+    }
+    return reader;
+}
+
+void RcuReader::Synchronize() {
+    uint64_t epoch = s_epoch.fetch_add(1);
+    if (s_membarrier) {
+        syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+    }
+    for (RcuReader* reader = s_readers.load(); reader; reader = reader->m_next) {
+        // 当前线程读取期间修改其他对象(如Logger::setFormatter)，不能等待自己
+        if (reader == t_reader) {
+            continue;
+        }
+        for (;;) {
+            uint64_t e = reader->m_epoch.load();
+            if (e == 0 || e > epoch) {
+                break;
+            }
+            std::this_thread::yield();
+        }
+    }
+}
+
+RcuReader* RcuReader::Acquire() {
+    static thread_local RcuReaderReleaser s_releaser;
+    RcuReader* reader = s_readers.load();
+    for (; reader; reader = reader->m_next) {
+        bool used = false;
+        if (!reader->m_used.load(std::memory_order_relaxed) && reader->m_used.compare_exchange_strong(used, true)) {
+            break;
+        }
+    }
+    if (!reader) {
+        reader         = new RcuReader;
+        reader->m_used = true;
+        reader->m_next = s_readers.load();
+        while (!s_readers.compare_exchange_weak(reader->m_next, reader)) {
+        }
+    }
+    t_reader = reader;
+    return reader;
+}
+
+void RcuReader::Release() {
+    if (t_reader) {
+        t_reader->m_used.store(false);
+        t_reader = nullptr;
+    }
+}
+
+void RcuReader::ResetAfterFork() {
+    for (RcuReader* reader = s_readers.load(); reader; reader = reader->m_next) {
+        if (reader != t_reader) {
+            reader->m_epoch = 0;
+            reader->m_depth = 0;
+            reader->m_used  = false;
+        }
+    }
+}
+
+}  // namespace mylog
@@ -0,0 +1,104 @@
+#ifndef __MYLOG_RCU_H__
+#define __MYLOG_RCU_H__
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+
+#include "util.h"
+
+namespace mylog {
+
+/**
+ * 读取方登记(所有RcuValue共用)
+ * 每个线程占用一条独立缓存行上的记录，读取时只写自己的记录，不写任何共享数据。
+ * 记录里保存进入读取时的全局纪元(0表示不在读取)，嵌套读取只在最外层登记。
+ * 线程退出后记录标记为空闲给新线程复用，不会释放。
+ */
+class alignas(MYLOG_CACHE_LINE_SIZE) RcuReader {
+   public:
+    // 进入读取，返回当前线程的记录
+    static RcuReader* Enter();
+    // 退出读取
+    static void Leave(RcuReader* reader) {
+        if (--reader->m_depth == 0) {
+            reader->m_epoch.store(0, std::memory_order_release);
+        }
+    }
+    // 等待在此之前进入读取的线程全部退出(不等待当前线程自己)
+    static void Synchronize();
+
+   private:
+    friend struct RcuReaderReleaser;
+    friend struct RcuForkIniter;
+    static RcuReader* Acquire();
+    static void Release();
+    static void ResetAfterFork();
+
+   private:
+    // 进入读取时的全局纪元，0表示不在读取
+    std::atomic<uint64_t> m_epoch{0};
+    // 嵌套层数，只由所属线程访问
+    uint32_t m_depth = 0;
+    // 是否被某个线程占用
+    std::atomic<bool> m_used{false};
+    RcuReader* m_next = nullptr;
+};
+
+/**
+ * 读多写少的数据(RCU方式发布)
+ * 写入方复制一份新值后整体替换，读取方不加锁，也不会被写入方阻塞；
+ * 旧值在所有可能读到它的读取方退出后才释放(写入方等待)。
+ * 读取方只在自己线程的记录里登记进入时的纪元(见RcuReader)，写入方替换后推进纪元，
+ * 只需要等待纪元推进前进入的读取方，新进入的读取方不会让写入方饿死。
+ * 注意: 不能在读取期间修改同一个对象(会释放正在读取的旧值)
+ */
+template <class T>
+class RcuValue {
+   public:
+    // 读取期间当前值不会被释放
+    class ReadLock {
+       public:
+        ReadLock(const RcuValue& rcu) : m_reader(RcuReader::Enter()), m_value(rcu.m_value.load()) {}
+        ~ReadLock() { RcuReader::Leave(m_reader); }
+        ReadLock(const ReadLock&) = delete;
+        ReadLock& operator=(const ReadLock&) = delete;
+
+        const T& get() const { return *m_value; }
+        const T& operator*() const { return *m_value; }
+        const T* operator->() const { return m_value; }
+
+       private:
+        RcuReader* m_reader;
+        const T* m_value;
+    };
+
+    RcuValue(const T& value = T()) : m_value(new T(value)) {}
+    ~RcuValue() { delete m_value.load(); }
+    RcuValue(const RcuValue&) = delete;
+    RcuValue& operator=(const RcuValue&) = delete;
+
+    // 复制当前值
+    T load() const {
+        ReadLock lock(*this);
+        return lock.get();
+    }
+
+    // 发布新值，旧值不再被读取后返回
+    void store(const T& value) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        T* old = m_value.exchange(new T(value));
+        RcuReader::Synchronize();
+        delete old;
+    }
+
+   private:
+    std::atomic<T*> m_value;
+    // 写入方之间互斥
+    std::mutex m_mutex;
+};
+
+}  // namespace mylog
+
+#endif
@@ -1,16 +1,218 @@
 #include "util.h"
 
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define MYLOG_HAVE_TSC 1
+#endif
+
 namespace mylog
 {
 /**
  * 这里不使用pthread_self返回的线程ID是因为pthread_self返回的是pthread库的线程id，
  * 不同进程间的线程id可能相同，这里使用syscall返回的是Linux下的线程id
 */
+static thread_local pid_t t_threadId = 0;
+static thread_local const char* t_threadName = nullptr;
+
+// fork后子进程中只有调用fork的线程，线程ID发生变化，清空缓存
+static void ResetThreadIdAfterFork() { t_threadId = 0; }
+
+struct ThreadIdIniter {
+    ThreadIdIniter() { pthread_atfork(nullptr, nullptr, ResetThreadIdAfterFork); }
+};
+static ThreadIdIniter s_threadIdIniter;
+
 pid_t GetThreadId() {
-    return syscall(SYS_gettid);
+    if (MYLOG_UNLIKELY(!t_threadId)) {
+        t_threadId = syscall(SYS_gettid);
+    }
+    return t_threadId;
+}
+
+// 线程名称只增不减(数量很少)，返回的指针一直有效，日志事件可以直接保存指针
+static const char* InternThreadName(const char* name) {
+    static std::mutex s_mutex;
+    static std::set<std::string>* s_names = new std::set<std::string>;
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return s_names->insert(name).first->c_str();
+}
+
+void SetThreadName(const char* name) {
+    t_threadName = InternThreadName(name);
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%s", name);
+    pthread_setname_np(pthread_self(), buf);
+}
+
+const char* GetThreadName() {
+    if (MYLOG_UNLIKELY(!t_threadName)) {
+        char buf[16] = {0};
+        pthread_getname_np(pthread_self(), buf, sizeof(buf));
+        t_threadName = InternThreadName(buf);
+    }
+    return t_threadName;
 }
 
 u_int32_t GetFiberId(){
     return 0;
 }
+
+static uint64_t ReadClockNs(clockid_t id) {
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+#ifdef MYLOG_HAVE_TSC
+/**
+ * TSC时钟: ns = baseNs + (tsc - baseTsc) * mult / 2^32
+ * 基准点与频率由一个seqlock保护，读取方不加锁；距离基准点超过1秒时，
+ * 由一个调用线程用clock_gettime重新同步基准点并按照更长的区间重新校准频率
+ * 同步时新的基准点不早于按照旧基准点推算的时间，保证不会回退；读取方不写共享数据
+ */
+class TscClock {
+   public:
+    // CPU是否支持恒定频率的TSC
+    static bool IsSupported() {
+        std::ifstream ifs("/proc/cpuinfo");
+        std::string line;
+        while (std::getline(ifs, line)) {
+            if (line.compare(0, 5, "flags") == 0) {
+                return line.find(" constant_tsc") != std::string::npos &&
+                       line.find(" nonstop_tsc") != std::string::npos;
+            }
+        }
+        return false;
+    }
+
+    TscClock() {
+        // 初次校准，忙等1毫秒
+        uint64_t tsc = __rdtsc();
+        uint64_t ns  = ReadClockNs(CLOCK_REALTIME);
+        uint64_t now = ns;
+        while (now - ns < 1000000) {
+            now = ReadClockNs(CLOCK_REALTIME);
+        }
+        uint64_t ticks = __rdtsc() - tsc;
+        m_calibTsc     = tsc;
+        m_calibNs      = ns;
+        publish(tsc, ns, ticks ? (static_cast<unsigned __int128>(now - ns) << 32) / ticks : 0);
+    }
+
+    uint64_t now() {
+        uint64_t base_tsc, base_ns, mult, resync_ticks;
+        uint32_t seq;
+        do {
+            seq          = m_seq.load(std::memory_order_acquire);
+            base_tsc     = m_baseTsc.load(std::memory_order_acquire);
+            base_ns      = m_baseNs.load(std::memory_order_acquire);
+            mult         = m_mult.load(std::memory_order_acquire);
+            resync_ticks = m_resyncTicks.load(std::memory_order_acquire);
+        } while ((seq & 1) || seq != m_seq.load(std::memory_order_relaxed));
+
+        uint64_t tsc = __rdtsc();
+        // 没有屏障保证__rdtsc在读取基准点之后执行，tsc可能略小于基准点
+        uint64_t ticks = static_cast<int64_t>(tsc - base_tsc) > 0 ? tsc - base_tsc : 0;
+        uint64_t ns    = base_ns + ((static_cast<unsigned __int128>(ticks) * mult) >> 32);
+        if (ticks > resync_ticks && !m_resyncing.exchange(true, std::memory_order_acquire)) {
+            // 读取基准点之后其他线程可能已经同步过
+            if (m_baseTsc.load(std::memory_order_relaxed) == base_tsc) {
+                uint64_t real = ReadClockNs(CLOCK_REALTIME);
+                if (tsc > m_calibTsc && real > m_calibNs) {
+                    mult = (static_cast<unsigned __int128>(real - m_calibNs) << 32) / (tsc - m_calibTsc);
+                }
+                // 不早于按照旧基准点推算的时间
+                ns = std::max(ns, real);
+                publish(tsc, ns, mult);
+            }
+            m_resyncing.store(false, std::memory_order_release);
+        }
+        return ns;
+    }
+
+   private:
+    void publish(uint64_t tsc, uint64_t ns, uint64_t mult) {
+        uint32_t seq = m_seq.load(std::memory_order_relaxed);
+        m_seq.store(seq + 1, std::memory_order_relaxed);
+        // 使用release写入，保证不会早于上面的奇数序号被看到
+        m_baseTsc.store(tsc, std::memory_order_release);
+        m_baseNs.store(ns, std::memory_order_release);
+        m_mult.store(mult, std::memory_order_release);
+        // 1秒对应的tick数
+        m_resyncTicks.store(mult ? (1000000000ULL << 32) / mult : 0, std::memory_order_release);
+        m_seq.store(seq + 2, std::memory_order_release);
+    }
+
+   private:
+    std::atomic<uint32_t> m_seq{0};
+    std::atomic<uint64_t> m_baseTsc{0};
+    std::atomic<uint64_t> m_baseNs{0};
+    std::atomic<uint64_t> m_mult{0};
+    std::atomic<uint64_t> m_resyncTicks{0};
+    // 同一时间只有一个线程重新同步
+    std::atomic<bool> m_resyncing{false};
+    // 校准频率的起点(只在同步时访问)
+    uint64_t m_calibTsc = 0;
+    uint64_t m_calibNs  = 0;
+};
+
+static TscClock& GetTscClock() {
+    static TscClock s_clock;
+    return s_clock;
+}
+#endif
+
+static std::atomic<int> s_clockSource{CLOCK_SOURCE_REALTIME};
+
+bool SetClockSource(ClockSource source) {
+    if (source == CLOCK_SOURCE_TSC) {
+#ifdef MYLOG_HAVE_TSC
+        if (!TscClock::IsSupported()) {
+            return false;
+        }
+#else
+        return false;
+#endif
+    }
+    s_clockSource = source;
+    return true;
+}
+
+ClockSource GetClockSource() { return static_cast<ClockSource>(s_clockSource.load(std::memory_order_relaxed)); }
+
+struct timespec GetRealTime() {
+    struct timespec ts;
+    switch (GetClockSource()) {
+#ifdef MYLOG_HAVE_TSC
+        case CLOCK_SOURCE_TSC: {
+            uint64_t ns = GetTscClock().now();
+            ts.tv_sec   = ns / 1000000000;
+            ts.tv_nsec  = ns % 1000000000;
+            break;
+        }
+#endif
+        case CLOCK_SOURCE_COARSE:
+            clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+            break;
+        default:
+            clock_gettime(CLOCK_REALTIME, &ts);
+            break;
+    }
+    return ts;
+}
+
+uint64_t GetStartTimeNs() {
+    static const uint64_t s_startTimeNs = ReadClockNs(CLOCK_REALTIME);
+    return s_startTimeNs;
+}
+
+// 库加载时记录启动时间
+static const uint64_t s_startTimeInit = GetStartTimeNs();
 } // namespace mylog
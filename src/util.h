@@ -7,15 +7,56 @@
 #include <sys/syscall.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <time.h>
+
+// 分支预测提示
+#if defined(__GNUC__) || defined(__clang__)
+#define MYLOG_LIKELY(x) __builtin_expect(!!(x), 1)
+#define MYLOG_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#define MYLOG_LIKELY(x) (x)
+#define MYLOG_UNLIKELY(x) (x)
+#endif
+
+// 缓存行大小，用于隔开多个线程频繁访问的数据
+#define MYLOG_CACHE_LINE_SIZE 64
 
 namespace mylog
 {
-// 获取系统中线程ID
+// 获取系统中线程ID(线程内缓存，fork后的子进程重新获取)
 pid_t GetThreadId();
 
+// 设置当前线程的名称(同时设置到系统中，超过15个字符时系统中的名称被截断)
+void SetThreadName(const char* name);
+// 当前线程的名称，没有设置时为系统中的线程名称(默认是进程名)
+// 返回的字符串不会被释放，可以在其他线程中使用
+const char* GetThreadName();
+
 // 获取协程ID
 u_int32_t GetFiberId();
 
+// 日志时间戳使用的时钟源
+enum ClockSource {
+    // clock_gettime(CLOCK_REALTIME)
+    CLOCK_SOURCE_REALTIME = 0,
+    // clock_gettime(CLOCK_REALTIME_COARSE)，开销最小，但精度只有一个时钟节拍(通常为1~4毫秒)
+    CLOCK_SOURCE_COARSE = 1,
+    // 读取TSC并按照校准的频率换算为系统时间，每秒与系统时间重新同步一次，返回的时间不会回退
+    // 只在CPU支持恒定频率的TSC(constant_tsc、nonstop_tsc)时可用，需要通过SetClockSource或者配置log_clock开启
+    CLOCK_SOURCE_TSC = 2
+};
+
+// 设置时钟源，不支持时返回false并保持原来的时钟源
+bool SetClockSource(ClockSource source);
+// 当前时钟源，默认使用CLOCK_REALTIME
+ClockSource GetClockSource();
+
+// 获取当前时间(精确到纳秒)
+struct timespec GetRealTime();
+
+// 进程启动(本库加载)时的时间，单位纳秒
+uint64_t GetStartTimeNs();
+
 } // namespace mylog
 
 
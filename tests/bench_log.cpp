@@ -0,0 +1,658 @@
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "log.h"
+#include "log_io.h"
+#include "log_static.h"
+
+// 构建类型与libmylog的来源(CMakeLists.txt设置)
+#ifndef MYLOG_BENCH_BUILD_TYPE
+#define MYLOG_BENCH_BUILD_TYPE "unknown"
+#endif
+#ifndef MYLOG_BENCH_LIBRARY
+#define MYLOG_BENCH_LIBRARY "unknown"
+#endif
+
+// 替换全局的operator new，统计堆内存申请次数(包括后台线程)
+static std::atomic<size_t> s_allocs{0};
+
+void* operator new(size_t size) {
+    s_allocs.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// 一项测试的结果，全部写入json文件
+struct BenchResult {
+    std::string name;
+    size_t threads = 1;
+    // 每次调用的平均耗时(纳秒)
+    double ns_per_op = 0;
+    // 每秒调用次数(所有线程合计)
+    double ops_per_sec = 0;
+    // 每次调用耗时的分位数(纳秒)，没有测量时为0
+    double p50  = 0;
+    double p99  = 0;
+    double p999 = 0;
+    // 每次调用的堆内存申请次数，没有测量时为-1
+    double allocs_per_op = -1;
+};
+
+static std::vector<BenchResult> s_results;
+
+static void record(const std::string& name, double ns_per_op) {
+    BenchResult result;
+    result.name        = name;
+    result.ns_per_op   = ns_per_op;
+    result.ops_per_sec = ns_per_op > 0 ? 1e9 / ns_per_op : 0;
+    s_results.push_back(result);
+}
+
+// 返回每次调用的平均耗时(纳秒)
+template <class F>
+double bench(size_t n, F f) {
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        f(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / (double)n;
+}
+
+// threads个线程各调用n次f(i)，记录每次调用的耗时，返回吞吐、分位数、内存申请次数
+template <class F>
+BenchResult bench_latency(const std::string& name, size_t threads, size_t n, F f) {
+    std::vector<std::vector<uint32_t>> latencies(threads, std::vector<uint32_t>(n));
+    std::vector<std::thread> workers;
+    size_t allocs = s_allocs.load();
+    auto begin    = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            auto& lat = latencies[t];
+            for (size_t i = 0; i < n; ++i) {
+                auto b = std::chrono::steady_clock::now();
+                f(i);
+                auto e = std::chrono::steady_clock::now();
+                lat[i] = (uint32_t)std::min<int64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(e - b).count(), UINT32_MAX);
+            }
+        });
+    }
+    for (auto& i : workers) {
+        i.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    allocs   = s_allocs.load() - allocs;
+
+    std::vector<uint32_t> all;
+    all.reserve(threads * n);
+    for (auto& i : latencies) {
+        all.insert(all.end(), i.begin(), i.end());
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p) { return (double)all[std::min(all.size() - 1, (size_t)(all.size() * p))]; };
+
+    BenchResult result;
+    result.name          = name;
+    result.threads       = threads;
+    double total_ns      = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+    result.ops_per_sec   = threads * n * 1e9 / total_ns;
+    result.ns_per_op     = total_ns / n;
+    result.p50           = percentile(0.5);
+    result.p99           = percentile(0.99);
+    result.p999          = percentile(0.999);
+    result.allocs_per_op = allocs / (double)(threads * n);
+    s_results.push_back(result);
+    return result;
+}
+
+static void print_latency(const BenchResult& result) {
+    std::cout << result.name << " (" << result.threads << " threads): " << result.ops_per_sec << " logs/s, p50 "
+              << result.p50 << " ns, p99 " << result.p99 << " ns, p999 " << result.p999 << " ns, allocs/op "
+              << result.allocs_per_op << "\n";
+}
+
+static std::string json_escape(const std::string& str) {
+    std::string rt;
+    for (char c : str) {
+        if (c == '"' || c == '\\') {
+            rt.push_back('\\');
+            rt.push_back(c);
+        } else if ((unsigned char)c < 0x20) {
+            char tmp[8];
+            snprintf(tmp, sizeof(tmp), "\\u%04x", c);
+            rt.append(tmp);
+        } else {
+            rt.push_back(c);
+        }
+    }
+    return rt;
+}
+
+// 结果写入json文件，方便对比不同版本
+static bool write_json(const std::string& filename) {
+    std::ofstream ofs(filename);
+    if (!ofs) {
+        return false;
+    }
+    ofs << "{\n  \"time\": " << time(0) << ",\n  \"cpus\": " << std::thread::hardware_concurrency()
+        << ",\n  \"build_type\": \"" << json_escape(MYLOG_BENCH_BUILD_TYPE) << "\",\n  \"library\": \""
+        << json_escape(MYLOG_BENCH_LIBRARY) << "\",\n  \"results\": [\n";
+    for (size_t i = 0; i < s_results.size(); ++i) {
+        auto& r = s_results[i];
+        ofs << "    {\"name\": \"" << json_escape(r.name) << "\", \"threads\": " << r.threads
+            << ", \"ns_per_op\": " << r.ns_per_op << ", \"ops_per_sec\": " << r.ops_per_sec << ", \"p50\": " << r.p50
+            << ", \"p99\": " << r.p99 << ", \"p999\": " << r.p999 << ", \"allocs_per_op\": " << r.allocs_per_op
+            << "}" << (i + 1 < s_results.size() ? "," : "") << "\n";
+    }
+    ofs << "  ]\n}\n";
+    return !!ofs;
+}
+
+MYLOG_STATIC_FORMATTER(DefaultFormatter, "%d%T%t %T%F%T[%p]%T[%c]%T%f:%l %T%m%n");
+
+// 编译后的指令 与 逐个FormatItem虚函数调用 的对比
+void bench_formatter() {
+    const char* patterns[] = {
+        "%d%T%t %T%F%T[%p]%T[%c]%T%f:%l %T%m%n",
+        "%d%T%m%n",
+        "%t %F [%p] [%c] %f:%l %m%n",
+        "%d{%Y-%m-%d %H:%M:%S.%L}%T%m%n",
+        "%m%n",
+    };
+    const size_t n = 200000;
+
+    mylog::Logger::ptr logger(new mylog::Logger("bench"));
+    mylog::LogEvent::ptr event(new mylog::LogEvent(logger, mylog::LogLevel::INFO, __FILE__, __LINE__,
+                                                   mylog::GetThreadId(), mylog::GetFiberId(), mylog::GetRealTime()));
+    event->getSS() << "benchmark formatter message";
+
+    for (auto pattern : patterns) {
+        mylog::LogFormatter::ptr fmt(new mylog::LogFormatter(pattern));
+        if (fmt->format(logger, event->getLevel(), event) != fmt->formatItems(logger, event->getLevel(), event)) {
+            std::cout << "formatter \"" << pattern << "\" output mismatch\n";
+        }
+        size_t total = 0;
+        double items = bench(n, [&](size_t) { total += fmt->formatItems(logger, event->getLevel(), event).size(); });
+        std::string buf;
+        double program = bench(n, [&](size_t) {
+            buf.clear();
+            fmt->format(buf, logger, event->getLevel(), event);
+            total += buf.size();
+        });
+        std::cout << "formatter \"" << pattern << "\" items: " << items << " ns/op, program: " << program
+                  << " ns/op (" << total << ")\n";
+        record(std::string("formatter items ") + pattern, items);
+        record(std::string("formatter program ") + pattern, program);
+    }
+
+    // 编译期解析的格式
+    mylog::LogFormatter::ptr fmt(new mylog::LogFormatter(DefaultFormatter_mylog_pattern));
+    std::string expect = fmt->format(logger, event->getLevel(), event);
+    std::string buf;
+    DefaultFormatter::format(buf, event->getLevel(), *event);
+    if (buf != expect) {
+        std::cout << "static formatter output mismatch\n";
+    }
+    size_t total  = 0;
+    double result = bench(n, [&](size_t) {
+        buf.clear();
+        DefaultFormatter::format(buf, event->getLevel(), *event);
+        total += buf.size();
+    });
+    std::cout << "static formatter \"" << DefaultFormatter_mylog_pattern << "\": " << result << " ns/op (" << total
+              << ")\n";
+    record(std::string("formatter static ") + DefaultFormatter_mylog_pattern, result);
+}
+
+// 带结构化字段的日志: 文本格式 与 JSON格式 的对比
+void bench_json() {
+    const size_t n = 200000;
+    mylog::Logger::ptr logger(new mylog::Logger("bench"));
+    mylog::LogEvent::ptr event(new mylog::LogEvent(logger, mylog::LogLevel::INFO, __FILE__, __LINE__,
+                                                   mylog::GetThreadId(), mylog::GetFiberId(), mylog::GetRealTime()));
+    event->getSS().kv("user", "william").kv("id", 12345).kv("latency_us", 12.5).kv("ok", true)
+        << "benchmark \"json\" message";
+    mylog::LogFormatter::ptr formats[] = {mylog::LogFormatter::Create("%d%T%t %T%F%T[%p]%T[%c]%T%f:%l %T%m%n"),
+                                          mylog::LogFormatter::Create(mylog::JsonFormatter::kName)};
+    const char* names[]                = {"text", "json"};
+    for (size_t k = 0; k < 2; ++k) {
+        std::string buf;
+        size_t total  = 0;
+        double result = bench(n, [&](size_t) {
+            buf.clear();
+            formats[k]->format(buf, logger, event->getLevel(), event);
+            total += buf.size();
+        });
+        std::cout << "fields formatter " << names[k] << ": " << result << " ns/op (" << total << ")\n";
+        record(std::string("fields formatter ") + names[k], result);
+    }
+}
+
+// 缓存的日期渲染 与 每次调用localtime_r/strftime 的对比，时间每次前进1毫秒
+void bench_datetime() {
+    const char* fmt = "%Y-%m-%d %H:%M:%S";
+    const size_t n  = 200000;
+    time_t begin    = time(0);
+    std::string buf;
+    size_t total  = 0;
+    double cached = bench(n, [&](size_t i) {
+        buf.clear();
+        mylog::LogFormatter::AppendDateTime(buf, fmt, begin + i / 1000, i % 1000 * 1000000);
+        total += buf.size();
+    });
+    double strftime_only = bench(n, [&](size_t i) {
+        struct tm tm;
+        time_t t = begin + i / 1000;
+        localtime_r(&t, &tm);
+        char str[64];
+        total += strftime(str, sizeof(str), fmt, &tm);
+    });
+    std::cout << "datetime \"" << fmt << "\" cached: " << cached << " ns/op, localtime_r+strftime: " << strftime_only
+              << " ns/op (" << total << ")\n";
+}
+
+// 日志内容的写入: LogStream 与 std::stringstream 的对比
+void bench_stream() {
+    const size_t n   = 200000;
+    std::string name = "william";
+    size_t total     = 0;
+    mylog::LogStream ls;
+    double log_stream = bench(n, [&](size_t i) {
+        ls.clear();
+        ls << "user=" << name << " id=" << i << " cost=" << i * 0.25 << " ok=" << true;
+        total += ls.size();
+    });
+    double string_stream = bench(n, [&](size_t i) {
+        std::stringstream ss;
+        ss << "user=" << name << " id=" << i << " cost=" << i * 0.25 << " ok=" << true;
+        total += ss.str().size();
+    });
+    // 格式化为文本: {}占位符 与 printf格式(延迟格式化的参数在输出时渲染)
+    mylog::Logger::ptr logger(new mylog::Logger("bench"));
+    double brace = bench(n, [&](size_t i) {
+        auto event = mylog::LogEvent::Create(logger, mylog::LogLevel::INFO, __FILE__, __LINE__, 0, 0,
+                                             mylog::GetRealTime());
+        event->getSS().print([]() constexpr { return "user={} id={} cost={:.2f} ok={}"; }, name, i, i * 0.25, true);
+        total += event->getSS().size();
+    });
+    std::string content;
+    double printf_fmt = bench(n, [&](size_t i) {
+        auto event = mylog::LogEvent::Create(logger, mylog::LogLevel::INFO, __FILE__, __LINE__, 0, 0,
+                                             mylog::GetRealTime());
+        event->format("user=%s id=%zu cost=%.2f ok=%d", name, i, i * 0.25, 1);
+        content.clear();
+        event->appendContent(content);
+        total += content.size();
+    });
+    std::cout << "stream LogStream: " << log_stream << " ns/op, std::stringstream: " << string_stream
+              << " ns/op, {} format: " << brace << " ns/op, printf format: " << printf_fmt << " ns/op (" << total
+              << ")\n";
+    record("stream LogStream", log_stream);
+    record("stream std::stringstream", string_stream);
+    record("format {}", brace);
+    record("format printf", printf_fmt);
+}
+
+// 各时钟源获取时间戳的开销
+void bench_clock() {
+    const mylog::ClockSource sources[] = {mylog::CLOCK_SOURCE_REALTIME, mylog::CLOCK_SOURCE_COARSE,
+                                          mylog::CLOCK_SOURCE_TSC};
+    const char* names[]                = {"realtime", "coarse", "tsc"};
+    const size_t n                     = 1000000;
+    mylog::ClockSource old             = mylog::GetClockSource();
+    for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); ++i) {
+        if (!mylog::SetClockSource(sources[i])) {
+            std::cout << "clock " << names[i] << ": unsupported\n";
+            continue;
+        }
+        uint64_t total = 0;
+        double result  = bench(n, [&](size_t) { total += mylog::GetRealTime().tv_nsec; });
+        std::cout << "clock " << names[i] << ": " << result << " ns/op (" << total % 10 << ")\n";
+    }
+    mylog::SetClockSource(old);
+}
+
+// 按名称查找日志器: 不同注册数量下的查找、调用处缓存、多线程并发查找
+void bench_registry() {
+    const size_t counts[] = {10, 1000, 10000};
+    const size_t n        = 200000;
+    size_t created        = 1;
+    for (auto count : counts) {
+        for (; created < count; ++created) {
+            MYLOG_LOG_NAME("registry_" + std::to_string(created));
+        }
+        std::string name = "registry_" + std::to_string(count / 2);
+        size_t total     = 0;
+        double result    = bench(n, [&](size_t) { total += MYLOG_LOG_NAME(name)->getName().size(); });
+        std::cout << "registry lookup (" << count << " loggers): " << result << " ns/op (" << total << ")\n";
+    }
+
+    size_t total  = 0;
+    double cached = bench(n, [&](size_t) { total += MYLOG_LOG_NAME_CACHED("registry_5")->getName().size(); });
+    std::cout << "registry cached lookup: " << cached << " ns/op (" << total << ")\n";
+
+    constexpr size_t threads = 4;
+    std::vector<std::thread> workers;
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([t]() {
+            for (size_t i = 0; i < n; ++i) {
+                MYLOG_LOG_NAME("registry_" + std::to_string((i * threads + t) % 1000 + 1));
+            }
+        });
+    }
+    for (auto& i : workers) {
+        i.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "registry lookup (" << threads << " threads): "
+              << std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / (double)(n * threads)
+              << " ns/op\n";
+}
+
+// 关闭的日志语句的开销: 运行期级别过滤 与 编译期删除(低于MYLOG_MIN_LEVEL)
+void bench_disabled() {
+    const size_t n = 10000000;
+    mylog::Logger::ptr logger(new mylog::Logger("bench_disabled"));
+    logger->setLevel(mylog::LogLevel::ERROR);
+    std::string name = "william";
+    volatile size_t sink = 0;
+    double empty = bench(n, [&](size_t i) { sink = i; });
+    double stream = bench(n, [&](size_t i) {
+        sink = i;
+        MYLOG_LOG_DEBUG(logger) << "user=" << name << " id=" << i;
+    });
+    double fmt = bench(n, [&](size_t i) {
+        sink = i;
+        MYLOG_LOG_FMT_INFO(logger, "user=%s id=%zu", name.c_str(), i);
+    });
+    double compiled_out = bench(n, [&](size_t i) {
+        sink = i;
+        MYLOG_LOG_LEVEL(logger, mylog::LogLevel::UNKNOWN) << "user=" << name << " id=" << i;
+    });
+    logger->setLevel(mylog::LogLevel::DEBUG);
+    double every_n = bench(n, [&](size_t i) {
+        sink = i;
+        MYLOG_LOG_EVERY_N(logger, mylog::LogLevel::INFO, 1000000000) << "user=" << name << " id=" << i;
+    });
+    std::cout << "disabled empty loop: " << empty << " ns/op, stream: " << stream << " ns/op, fmt: " << fmt
+              << " ns/op, below MYLOG_MIN_LEVEL: " << compiled_out << " ns/op, suppressed by EVERY_N: " << every_n
+              << " ns/op\n";
+    record("disabled empty loop", empty);
+    record("disabled stream", stream);
+    record("disabled fmt", fmt);
+    record("disabled below MYLOG_MIN_LEVEL", compiled_out);
+    record("disabled suppressed by EVERY_N", every_n);
+}
+
+// 单线程写入文件的吞吐: FileLogAppender(ofstream) 与 MmapFileLogAppender 的对比
+void bench_appender() {
+    const size_t n      = 200000;
+    std::string name    = "william";
+    const char* files[] = {"./bench_file.txt", "./bench_mmap.txt"};
+    unlink(files[0]);
+    unlink(files[1]);
+    mylog::LogAppender::ptr appenders[] = {
+        mylog::LogAppender::ptr(new mylog::FileLogAppender(files[0])),
+        mylog::LogAppender::ptr(new mylog::MmapFileLogAppender(files[1])),
+    };
+    const char* names[] = {"FileLogAppender", "MmapFileLogAppender"};
+    for (size_t k = 0; k < 2; ++k) {
+        mylog::Logger::ptr logger(new mylog::Logger("bench_appender"));
+        logger->addAppender(appenders[k]);
+        double result = bench(n, [&](size_t i) { MYLOG_LOG_INFO(logger) << "user=" << name << " id=" << i; });
+        std::cout << "appender " << names[k] << ": " << result << " ns/op, " << 1e9 / result << " logs/s\n";
+    }
+    unlink(files[0]);
+    unlink(files[1]);
+}
+
+// 逐条输出 与 批量输出(Logger::log(events)，每批64条) 的对比，两个Appender(文件、标准输出重定向到/dev/null)
+void bench_batch() {
+    const size_t n     = 200000;
+    const size_t batch = 64;
+    const char* file   = "./bench_batch.txt";
+    unlink(file);
+    mylog::Logger::ptr logger(new mylog::Logger("bench_batch"));
+    logger->addAppender(mylog::LogAppender::ptr(new mylog::FileLogAppender(file)));
+    logger->addAppender(mylog::LogAppender::ptr(new mylog::StdoutLogAppender));
+    auto create = [&](size_t i) {
+        auto event = mylog::LogEvent::Create(logger, mylog::LogLevel::INFO, __FILE__, __LINE__, mylog::GetThreadId(),
+                                             mylog::GetFiberId(), mylog::GetRealTime());
+        event->getSS() << "batch line " << i;
+        return event;
+    };
+
+    int null_fd   = open("/dev/null", O_WRONLY);
+    int stdout_fd = dup(STDOUT_FILENO);
+    std::cout.flush();
+    dup2(null_fd, STDOUT_FILENO);
+    double single = bench(n, [&](size_t i) { logger->log(mylog::LogLevel::INFO, create(i)); });
+    std::vector<mylog::LogEvent::ptr> events;
+    double batched = bench(n, [&](size_t i) {
+        events.push_back(create(i));
+        if (events.size() == batch) {
+            logger->log(events);
+            events.clear();
+        }
+    });
+    std::cout.flush();
+    dup2(stdout_fd, STDOUT_FILENO);
+    close(null_fd);
+    close(stdout_fd);
+    unlink(file);
+    std::cout << "batch single: " << single << " ns/op, batch of " << batch << ": " << batched << " ns/op\n";
+    record("batch single", single);
+    record("batch 64", batched);
+}
+
+// 按照conf/log.yml配置的root日志器(文件、标准输出两个Appender共用日志器的formatter)输出，
+// 与每个Appender配置相同格式、各自一个formatter(每个Appender重新格式化)的对比
+void bench_fanout() {
+    const size_t n      = 200000;
+    const char* file    = "./conf/log.yml";
+    YAML::Node shared   = YAML::LoadFile(file);
+    YAML::Node distinct = YAML::Clone(shared);
+    for (auto log : distinct["logs"]) {
+        for (auto appender : log["appenders"]) {
+            if (!appender["formatter"] && log["formatter"]) {
+                appender["formatter"] = log["formatter"].as<std::string>();
+            }
+        }
+    }
+
+    int null_fd   = open("/dev/null", O_WRONLY);
+    int stdout_fd = dup(STDOUT_FILENO);
+    std::cout.flush();
+    dup2(null_fd, STDOUT_FILENO);
+    double results[2];
+    YAML::Node configs[] = {shared, distinct};
+    for (size_t k = 0; k < 2; ++k) {
+        mylog::Config::LoadFromYaml(configs[k]);
+        mylog::Logger::ptr logger = MYLOG_LOG_NAME("root");
+        results[k] = bench(n, [&](size_t i) { MYLOG_LOG_INFO(logger) << "fanout line " << i; });
+    }
+    mylog::Config::LoadFromYaml(YAML::Load("logs: []"));
+    std::cout.flush();
+    dup2(stdout_fd, STDOUT_FILENO);
+    close(null_fd);
+    close(stdout_fd);
+    unlink("./root_log.txt");
+    unlink("./system_log.txt");
+    unlink("./async_log.txt");
+    std::cout << "fanout shared formatter: " << results[0] << " ns/op, distinct formatters: " << results[1]
+              << " ns/op\n";
+    record("fanout shared formatter", results[0]);
+    record("fanout distinct formatters", results[1]);
+}
+
+// 同时写入多个文件: AsyncLogAppender各自write 与 共用LogIoService(io_uring)批量写入 的对比
+void bench_io() {
+    const size_t files  = 16;
+    const size_t n      = 20000;
+    const char* names[] = {"write", "uring"};
+    for (size_t mode = 0; mode < 2; ++mode) {
+        std::vector<mylog::Logger::ptr> loggers;
+        std::vector<mylog::AsyncLogAppender::ptr> appenders;
+        for (size_t i = 0; i < files; ++i) {
+            std::string file = "./bench_io_" + std::to_string(i) + ".txt";
+            unlink(file.c_str());
+            mylog::Logger::ptr logger(new mylog::Logger("bench_io"));
+            mylog::AsyncLogAppender::ptr appender(new mylog::AsyncLogAppender(
+                file, 64 * 1024, 10, mylog::AsyncLogAppender::BLOCK, false, mode == 1));
+            logger->addAppender(appender);
+            loggers.push_back(logger);
+            appenders.push_back(appender);
+        }
+        mylog::LogIoService::Stats begin = mylog::LogIoService::GetInstance()->getStats();
+        double result                    = bench(n, [&](size_t i) {
+            for (auto& logger : loggers) {
+                MYLOG_LOG_INFO(logger) << "io line " << i;
+            }
+        });
+        for (auto& i : appenders) {
+            i->flush();
+        }
+        mylog::LogIoService::Stats end = mylog::LogIoService::GetInstance()->getStats();
+        std::cout << "io " << files << " files " << names[mode] << ": " << result / files << " ns/op";
+        if (mode == 1) {
+            std::cout << " (io_uring: " << mylog::LogIoService::GetInstance()->isUring()
+                      << ", syscalls: " << end.syscalls - begin.syscalls << ", writes: " << end.writes - begin.writes
+                      << ")";
+        }
+        std::cout << "\n";
+        appenders.clear();
+        loggers.clear();
+        for (size_t i = 0; i < files; ++i) {
+            unlink(("./bench_io_" + std::to_string(i) + ".txt").c_str());
+        }
+    }
+}
+
+// 各Appender单线程、多线程写入的吞吐、延迟分位数、内存申请次数
+// 标准输出重定向到/dev/null，文件写入当前目录
+void bench_appenders() {
+    const size_t n           = 100000;
+    constexpr size_t threads = 4;
+    std::string name         = "william";
+    struct Case {
+        const char* name;
+        const char* file;
+        std::function<mylog::LogAppender::ptr()> create;
+    };
+    const Case cases[] = {
+        {"stdout", nullptr, []() { return mylog::LogAppender::ptr(new mylog::StdoutLogAppender); }},
+        {"file", "./bench_appender_file.txt",
+         []() { return mylog::LogAppender::ptr(new mylog::FileLogAppender("./bench_appender_file.txt")); }},
+        {"mmap", "./bench_appender_mmap.txt",
+         []() { return mylog::LogAppender::ptr(new mylog::MmapFileLogAppender("./bench_appender_mmap.txt")); }},
+        {"rolling", "./bench_appender_rolling.txt",
+         []() {
+             return mylog::LogAppender::ptr(new mylog::RollingFileLogAppender("./bench_appender_rolling.txt", 0,
+                                                                              mylog::RollingFileLogAppender::NONE));
+         }},
+        {"async", "./bench_appender_async.txt",
+         []() { return mylog::LogAppender::ptr(new mylog::AsyncLogAppender("./bench_appender_async.txt")); }},
+        {"async_uring", "./bench_appender_uring.txt",
+         []() {
+             return mylog::LogAppender::ptr(new mylog::AsyncLogAppender(
+                 "./bench_appender_uring.txt", 4 * 1024 * 1024, 1000, mylog::AsyncLogAppender::BLOCK, false, true));
+         }},
+        {"ring", "./bench_appender_ring.txt",
+         []() { return mylog::LogAppender::ptr(new mylog::RingLogAppender("./bench_appender_ring.txt")); }},
+    };
+
+    int null_fd   = open("/dev/null", O_WRONLY);
+    int stdout_fd = dup(STDOUT_FILENO);
+    for (auto& c : cases) {
+        for (size_t t : {(size_t)1, threads}) {
+            if (c.file) {
+                unlink(c.file);
+            }
+            mylog::Logger::ptr logger(new mylog::Logger("bench_appenders"));
+            logger->addAppender(c.create());
+            auto f = [&](size_t i) { MYLOG_LOG_INFO(logger) << "user=" << name << " id=" << i; };
+            if (!c.file) {
+                std::cout.flush();
+                dup2(null_fd, STDOUT_FILENO);
+            }
+            // 预热: 对象池、格式化缓冲区、日期缓存
+            bench(1000, f);
+            BenchResult result = bench_latency(std::string("appender ") + c.name, t, n, f);
+            if (!c.file) {
+                std::cout.flush();
+                dup2(stdout_fd, STDOUT_FILENO);
+            }
+            print_latency(result);
+            logger->clearAppenders();
+            if (c.file) {
+                unlink(c.file);
+            }
+        }
+    }
+    close(null_fd);
+    close(stdout_fd);
+
+    // 不同格式写入文件
+    const char* patterns[] = {
+        "%d%T%t %T%F%T[%p]%T[%c]%T%f:%l %T%m%n",
+        "%d{%Y-%m-%d %H:%M:%S.%L}%T%m%n",
+        "%m%n",
+    };
+    for (auto pattern : patterns) {
+        const char* file = "./bench_appender_pattern.txt";
+        unlink(file);
+        mylog::Logger::ptr logger(new mylog::Logger("bench_patterns"));
+        logger->setFormatter(pattern);
+        logger->addAppender(mylog::LogAppender::ptr(new mylog::FileLogAppender(file)));
+        auto f = [&](size_t i) { MYLOG_LOG_INFO(logger) << "user=" << name << " id=" << i; };
+        bench(1000, f);
+        print_latency(bench_latency(std::string("pattern \"") + pattern + "\" file", 1, n, f));
+        logger->clearAppenders();
+        unlink(file);
+    }
+}
+
+// 用法: bench_log [结果文件(默认./bench_log.json)]
+int main(int argc, char** argv) {
+    std::cout << "build type: " << MYLOG_BENCH_BUILD_TYPE << ", libmylog: " << MYLOG_BENCH_LIBRARY << "\n";
+    bench_formatter();
+    bench_json();
+    bench_datetime();
+    bench_stream();
+    bench_clock();
+    bench_registry();
+    bench_disabled();
+    bench_appender();
+    bench_batch();
+    bench_io();
+    bench_appenders();
+    bench_fanout();
+
+    std::string output = argc > 1 ? argv[1] : "./bench_log.json";
+    if (!write_json(output)) {
+        std::cout << "write " << output << " failed\n";
+        return 1;
+    }
+    std::cout << "results: " << output << "\n";
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <stdlib.h>
+
+#include <atomic>
+#include <iostream>
+#include <new>
+
+#include "log.h"
+
+// 替换全局的operator new，统计堆内存申请次数
+static std::atomic<size_t> s_allocs{0};
+
+void* operator new(size_t size) {
+    ++s_allocs;
+    void* p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+// 统计写n条日志的堆内存申请次数
+template <class F>
+size_t count_allocs(size_t n, F f) {
+    size_t begin = s_allocs;
+    for (size_t i = 0; i < n; ++i) {
+        f(i);
+    }
+    return s_allocs - begin;
+}
+
+int main(int argc, char** argv) {
+    mylog::Logger::ptr logger(new mylog::Logger("alloc"));
+    logger->addAppender(mylog::LogAppender::ptr(new mylog::FileLogAppender("./alloc_log.txt")));
+    std::string name = "mylog";
+    const size_t n   = 10000;
+
+    auto stream_log = [&](size_t i) {
+        MYLOG_LOG_INFO(logger) << "stream log " << i << " value=" << 3.25 << " name=" << name;
+    };
+    auto fmt_log = [&](size_t i) { MYLOG_LOG_FMT_INFO(logger, "fmt log %zu value=%.2f name=%s", i, 3.25, name); };
+    auto kv_log  = [&](size_t i) { MYLOG_LOG_INFO(logger).kv("id", i).kv("value", 3.25).kv("name", name) << "kv log"; };
+    auto format_log = [&](size_t i) {
+        MYLOG_LOG_FORMAT_INFO(logger, "format log {} value={:.2f} name={}", i, 3.25, name);
+    };
+
+    // 预热：对象池、格式化缓冲区、日期缓存
+    count_allocs(100, stream_log);
+    count_allocs(100, fmt_log);
+    count_allocs(100, kv_log);
+    count_allocs(100, format_log);
+
+    size_t stream_allocs = count_allocs(n, stream_log);
+    size_t fmt_allocs    = count_allocs(n, fmt_log);
+    size_t kv_allocs     = count_allocs(n, kv_log);
+    size_t format_allocs = count_allocs(n, format_log);
+    std::cout << "stream log allocations: " << stream_allocs << " / " << n << "\n";
+    std::cout << "fmt log allocations: " << fmt_allocs << " / " << n << "\n";
+    std::cout << "kv log allocations: " << kv_allocs << " / " << n << "\n";
+    std::cout << "format log allocations: " << format_allocs << " / " << n << "\n";
+
+    // 超出内联空间的内容会申请堆内存，复用后不再申请
+    std::string long_str(1024, 'x');
+    auto long_log = [&](size_t i) { MYLOG_LOG_INFO(logger) << "long log " << i << " " << long_str; };
+    count_allocs(100, long_log);
+    std::cout << "long log allocations: " << count_allocs(n, long_log) << " / " << n << "\n";
+
+    if (stream_allocs || fmt_allocs || kv_allocs || format_allocs) {
+        std::cout << "hot path allocates\n";
+        return 1;
+    }
+    return 0;
+}
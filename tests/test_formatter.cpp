@@ -0,0 +1,109 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "log.h"
+#include "log_static.h"
+
+// 编译期格式(StaticFormatter)与运行期格式(LogFormatter)的输出必须逐字节一致
+// Logger默认使用StaticFormatter，两者出现差异会改变所有默认日志器的输出
+MYLOG_STATIC_FORMATTER(DefaultFormatter, "%d%T%t %T%F%T[%p]%T[%c]%T%f:%l %T%m%n");
+MYLOG_STATIC_FORMATTER(MillisFormatter, "%d{%Y-%m-%d %H:%M:%S.%L}%T%m%n");
+MYLOG_STATIC_FORMATTER(FractionFormatter, "%d{%H:%M:%S.%f}|%d{%S.%N}|%d%n");
+MYLOG_STATIC_FORMATTER(ElapseFormatter, "%r|%r{ms}|%r{us}|%r{ns}|%m%n");
+// 两种解析都只把"%%"中的第一个%当作文本，第二个%继续作为格式项的开始
+MYLOG_STATIC_FORMATTER(PercentFormatter, "%%p [%N] %%%m%n");
+MYLOG_STATIC_FORMATTER(MessageFormatter, "%m");
+MYLOG_STATIC_FORMATTER(FieldsFormatter, "[%c]%T[%p]%T%f:%l%T%t/%F/%N%T%m");
+
+static int s_failed = 0;
+
+static std::vector<mylog::LogEvent::ptr> make_events(const mylog::Logger::ptr& logger) {
+    std::vector<mylog::LogEvent::ptr> events;
+    const mylog::LogLevel::Level levels[] = {mylog::LogLevel::DEBUG, mylog::LogLevel::INFO, mylog::LogLevel::WARN,
+                                             mylog::LogLevel::ERROR, mylog::LogLevel::FATAL};
+    // 整秒、秒以下各位都不为0、跨分钟前的最后一纳秒
+    const uint64_t times[] = {1700000000ULL * 1000000000ULL, 1700000000ULL * 1000000000ULL + 123456789,
+                              1700000059ULL * 1000000000ULL + 999999999};
+    const uint64_t elapses[] = {0, 1234567, 987654321012ULL};
+    for (size_t i = 0; i < 5; ++i) {
+        struct timespec ts = {0, 0};
+        mylog::LogEvent::ptr event(new mylog::LogEvent(logger, levels[i], i % 2 ? "tests/test_formatter.cpp" : "a.cpp",
+                                                       static_cast<int32_t>(i * 1000), 100 + i, i, ts));
+        event->setTimeNs(times[i % 3]);
+        event->setElapseNs(elapses[i % 3]);
+        event->setThreadName(i % 2 ? "worker" : "");
+        switch (i) {
+            case 0:
+                // 空消息
+                break;
+            case 1:
+                event->getSS() << "stream message " << 42 << ' ' << 3.5;
+                break;
+            case 2:
+                event->format("printf %d %s %5.2f %%", 7, "args", 1.25);
+                break;
+            case 3:
+                event->getSS().kv("user", "william").kv("id", 12345) << "with fields";
+                break;
+            default:
+                event->getSS() << "100% \t tab %m %%";
+                break;
+        }
+        events.push_back(event);
+    }
+    return events;
+}
+
+template <class Formatter>
+static void check(const char* pattern, const mylog::Logger::ptr& logger,
+                  const std::vector<mylog::LogEvent::ptr>& events) {
+    mylog::LogFormatter::ptr runtime(new mylog::LogFormatter(pattern));
+    if (runtime->isError()) {
+        std::cout << "pattern \"" << pattern << "\" is invalid\n";
+        s_failed = 1;
+        return;
+    }
+    size_t mismatched = 0;
+    for (auto& event : events) {
+        std::string expect = runtime->format(logger, event->getLevel(), event);
+        std::string items  = runtime->formatItems(logger, event->getLevel(), event);
+        std::string actual;
+        Formatter::format(actual, event->getLevel(), *event);
+        if (actual != expect || items != expect) {
+            std::cout << "pattern \"" << pattern << "\" mismatch:\n  static:  [" << actual << "]\n  program: ["
+                      << expect << "]\n  items:   [" << items << "]\n";
+            ++mismatched;
+        }
+    }
+    std::cout << "pattern \"" << pattern << "\": " << events.size() - mismatched << "/" << events.size() << " match\n";
+    if (mismatched) {
+        s_failed = 1;
+    }
+}
+
+int main(int argc, char** argv) {
+    mylog::Logger::ptr logger(new mylog::Logger("formatter"));
+    std::vector<mylog::LogEvent::ptr> events = make_events(logger);
+    check<DefaultFormatter>(DefaultFormatter_mylog_pattern, logger, events);
+    check<MillisFormatter>(MillisFormatter_mylog_pattern, logger, events);
+    check<FractionFormatter>(FractionFormatter_mylog_pattern, logger, events);
+    check<ElapseFormatter>(ElapseFormatter_mylog_pattern, logger, events);
+    check<PercentFormatter>(PercentFormatter_mylog_pattern, logger, events);
+    check<MessageFormatter>(MessageFormatter_mylog_pattern, logger, events);
+    check<FieldsFormatter>(FieldsFormatter_mylog_pattern, logger, events);
+
+    // Logger默认的formatter
+    mylog::LogFormatter::ptr default_formatter = logger->getFormatter();
+    mylog::LogFormatter::ptr runtime(new mylog::LogFormatter(default_formatter->getPattern()));
+    for (auto& event : events) {
+        std::string actual = default_formatter->format(logger, event->getLevel(), event);
+        if (actual != runtime->format(logger, event->getLevel(), event)) {
+            std::cout << "logger default formatter mismatch: [" << actual << "]\n";
+            s_failed = 1;
+        }
+    }
+
+    std::cout << (s_failed ? "FAILED" : "OK") << "\n";
+    return s_failed;
+}
@@ -0,0 +1,117 @@
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "log.h"
+
+// 只统计条数并记录最后一条内容的Appender
+class CountLogAppender : public mylog::LogAppender {
+   public:
+    typedef std::shared_ptr<CountLogAppender> ptr;
+    void log(mylog::Logger::ptr logger, mylog::LogLevel::Level level, mylog::LogEvent::ptr event) override {
+        ++m_count;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_last = std::string(event->getSS().data(), event->getSS().size());
+    }
+    std::string toYamlString() override { return "type: CountLogAppender"; }
+
+    size_t count() const { return m_count; }
+    std::string last() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_last;
+    }
+    void reset() { m_count = 0; }
+
+   private:
+    std::atomic<size_t> m_count{0};
+    std::mutex m_mutex;
+    std::string m_last;
+};
+
+static int s_failed = 0;
+
+static void check(const char* name, size_t value, size_t expect) {
+    std::cout << name << ": " << value << " (expect " << expect << ")\n";
+    if (value != expect) {
+        s_failed = 1;
+    }
+}
+
+int main(int argc, char** argv) {
+    mylog::Logger::ptr logger(new mylog::Logger("limit"));
+    CountLogAppender::ptr counter(new CountLogAppender);
+    logger->addAppender(counter);
+
+    // 4个线程共用一个调用处
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&logger]() {
+            for (int i = 0; i < 2500; ++i) {
+                MYLOG_LOG_EVERY_N(logger, mylog::LogLevel::ERROR, 100) << "every n " << i;
+            }
+        });
+    }
+    for (auto& i : threads) {
+        i.join();
+    }
+    check("every_n(100) x 10000", counter->count(), 100);
+
+    counter->reset();
+    for (int i = 0; i < 10000; ++i) {
+        MYLOG_LOG_FIRST_N(logger, mylog::LogLevel::ERROR, 5) << "first n " << i;
+    }
+    check("first_n(5) x 10000", counter->count(), 5);
+
+    counter->reset();
+    for (int i = 0; i < 10000; ++i) {
+        MYLOG_LOG_EVERY_MS(logger, mylog::LogLevel::ERROR, 60000) << "every ms " << i;
+    }
+    check("every_ms(60000) x 10000", counter->count(), 1);
+
+    counter->reset();
+    for (int i = 0; i < 10000; ++i) {
+        MYLOG_LOG_RATE(logger, mylog::LogLevel::ERROR, 1, 20) << "rate " << i;
+    }
+    check("rate(1/s, burst 20) x 10000", counter->count(), 20);
+
+    // 被抑制的次数在下一条放行的日志中输出
+    counter->reset();
+    for (int i = 0; i < 11; ++i) {
+        MYLOG_LOG_EVERY_N(logger, mylog::LogLevel::ERROR, 10) << "summary " << i;
+    }
+    std::cout << "summary: " << counter->last() << "\n";
+    if (counter->last() != "[suppressed 9] summary 10") {
+        s_failed = 1;
+    }
+
+    // 关闭的级别不计入调用次数
+    counter->reset();
+    logger->setLevel(mylog::LogLevel::ERROR);
+    for (int i = 0; i < 100; ++i) {
+        MYLOG_LOG_EVERY_N(logger, mylog::LogLevel::INFO, 1) << "disabled " << i;
+    }
+    check("disabled every_n", counter->count(), 0);
+
+    // 通过YAML配置日志器的限流
+    mylog::Logger::ptr configured = MYLOG_LOG_NAME("limit_yaml");
+    mylog::Config::LoadFromYaml(YAML::Load("logs:\n"
+                                           "  - name: limit_yaml\n"
+                                           "    level: info\n"
+                                           "    rate_limit:\n"
+                                           "      rate: 1\n"
+                                           "      burst: 10\n"));
+    configured->clearAppenders();
+    configured->addAppender(counter);
+    counter->reset();
+    for (int i = 0; i < 1000; ++i) {
+        MYLOG_LOG_INFO(configured) << "yaml " << i;
+    }
+    check("yaml rate_limit(1/s, burst 10) x 1000", counter->count(), 10);
+    std::cout << mylog::LoggerMgr::GetInstance()->getLogger("limit_yaml")->toYamlString() << "\n";
+
+    std::cout << (s_failed ? "FAILED" : "OK") << "\n";
+    return s_failed;
+}
@@ -1,7 +1,10 @@
+#include <chrono>
 #include <iostream>
 #include <thread>
+#include <vector>
 
 #include "log.h"
+#include "log_binary.h"
 
 void basic_use_mylog() {
     mylog::Logger::ptr test_log = MYLOG_LOG_NAME("test_log");
@@ -10,7 +13,119 @@ void basic_use_mylog() {
     MYLOG_LOG_WARN(test_log) << "WARN log";
     MYLOG_LOG_ERROR(test_log) << "ERROR log";
     MYLOG_LOG_FATAL(test_log) << "FATAL log";
+    // {}占位符，格式串在编译期检查
+    MYLOG_LOG_FORMAT_INFO(test_log, "FORMAT log {} {:.2f} {:x}", "william", 3.14159, 255);
 }
+void async_use_mylog() {
+    mylog::Logger::ptr async_log = MYLOG_LOG_NAME("async_log");
+    mylog::AsyncLogAppender::ptr appender(
+        new mylog::AsyncLogAppender("./async_log.txt", 64 * 1024, 500, mylog::AsyncLogAppender::DROP_COUNT));
+    async_log->addAppender(appender);
+    for (int i = 0; i < 1000; ++i) {
+        MYLOG_LOG_INFO(async_log) << "async log " << i;
+    }
+    appender->flush();
+    std::cout << "async log dropped: " << appender->getDropped() << "\n";
+
+    // defer模式：调用线程只记录格式串和参数，格式化在后台线程完成
+    mylog::Logger::ptr defer_log = MYLOG_LOG_NAME("defer_log");
+    mylog::AsyncLogAppender::ptr defer_appender(
+        new mylog::AsyncLogAppender("./defer_log.txt", 64 * 1024, 500, mylog::AsyncLogAppender::BLOCK, true));
+    defer_log->addAppender(defer_appender);
+    std::string name = "william";
+    for (int i = 0; i < 10; ++i) {
+        MYLOG_LOG_FMT_INFO(defer_log, "defer log %d %s %5.2f %c %x %%", i, name, i * 1.5, 'a' + i, i * 255);
+    }
+    // 格式串不是字面量时在调用处立即格式化，格式串随后释放也不影响输出
+    for (int i = 0; i < 3; ++i) {
+        std::string fmt = "defer runtime fmt " + std::to_string(i) + " %d %s";
+        MYLOG_LOG_FMT_INFO(defer_log, fmt.c_str(), i, name);
+    }
+    defer_appender->flush();
+}
+
+void ring_use_mylog() {
+    mylog::Logger::ptr ring_log = MYLOG_LOG_NAME("ring_log");
+    mylog::RingLogAppender::ptr appender(new mylog::RingLogAppender("./ring_log.txt", 16 * 1024));
+    ring_log->addAppender(appender);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.push_back(std::thread([ring_log, t]() {
+            for (int i = 0; i < 1000; ++i) {
+                MYLOG_LOG_INFO(ring_log) << "ring log thread " << t << " " << i;
+            }
+        }));
+    }
+    for (auto& i : threads) {
+        i.join();
+    }
+    appender->flush();
+    for (auto& i : appender->getOverflowCounts()) {
+        std::cout << "ring log thread id: " << i.first << " overflow: " << i.second << "\n";
+    }
+    std::cout << "ring log overflow total: " << appender->getOverflowTotal() << "\n";
+}
+
+void thread_name_use_mylog() {
+    // 线程名称在线程内设置一次，%N输出
+    mylog::Logger::ptr name_log(new mylog::Logger("name_log"));
+    name_log->setFormatter("%t%T%N%T[%p]%T%m%n");
+    name_log->addAppender(mylog::LogAppender::ptr(new mylog::StdoutLogAppender));
+    MYLOG_LOG_INFO(name_log) << "default thread name";
+    std::thread worker([name_log]() {
+        mylog::SetThreadName("worker");
+        MYLOG_LOG_INFO(name_log) << "named thread";
+    });
+    worker.join();
+}
+
+void binary_use_mylog() {
+    // 同样的日志分别输出为文本和二进制，比较文件大小
+    mylog::Logger::ptr binary_log = MYLOG_LOG_NAME("binary_log");
+    mylog::FileLogAppender::ptr text_appender(new mylog::FileLogAppender("./text_log.txt"));
+    mylog::BinaryFileLogAppender::ptr binary_appender(new mylog::BinaryFileLogAppender("./binary_log.bin"));
+    binary_log->addAppender(text_appender);
+    binary_log->addAppender(binary_appender);
+    for (int i = 0; i < 1000; ++i) {
+        MYLOG_LOG_FMT_INFO(binary_log, "binary log user=%s id=%d cost=%.3f", "william", i, i * 0.25);
+    }
+    MYLOG_LOG_INFO(binary_log) << "binary stream log";
+    binary_appender->flush();
+
+    std::ifstream text("./text_log.txt", std::ios::ate | std::ios::binary);
+    std::ifstream binary("./binary_log.bin", std::ios::ate | std::ios::binary);
+    std::cout << "text log size: " << text.tellg() << " binary log size: " << binary.tellg()
+              << " (decode: mylog_decode binary_log.bin)\n";
+}
+
+// 返回文件当前的大小(已经写入内核的部分)
+static long file_size(const char* filename) {
+    std::ifstream ifs(filename, std::ios::ate | std::ios::binary);
+    return ifs ? static_cast<long>(ifs.tellg()) : -1;
+}
+
+void flush_use_mylog() {
+    // 默认ERROR及以上的日志立即写入文件
+    mylog::Logger::ptr flush_log(new mylog::Logger("flush_log"));
+    mylog::FileLogAppender::ptr appender(new mylog::FileLogAppender("./flush_log.txt"));
+    flush_log->addAppender(appender);
+    MYLOG_LOG_INFO(flush_log) << "flush info log";
+    std::cout << "after info: " << file_size("./flush_log.txt") << " bytes\n";
+    MYLOG_LOG_ERROR(flush_log) << "flush error log";
+    std::cout << "after error: " << file_size("./flush_log.txt") << " bytes\n";
+
+    // interval: 停止写入后由刷新线程写入
+    mylog::LogFlushPolicy policy;
+    policy.interval = 100;
+    appender->setFlushPolicy(policy);
+    // 第一条距离上次刷新已经超过interval，写入时就刷新；第二条留在缓冲区中
+    MYLOG_LOG_INFO(flush_log) << "flush interval log 1";
+    MYLOG_LOG_INFO(flush_log) << "flush interval log 2";
+    std::cout << "after info: " << file_size("./flush_log.txt") << " bytes\n";
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    std::cout << "after 300ms idle: " << file_size("./flush_log.txt") << " bytes\n";
+}
+
 int main(int argc, char** argv) {
     mylog::Logger::ptr logger(new mylog::Logger);
     logger->addAppender(mylog::LogAppender::ptr(new mylog::StdoutLogAppender));
@@ -33,5 +148,20 @@ int main(int argc, char** argv) {
     std::cout << "\n================================================\n\n";
     basic_use_mylog();
 
+    std::cout << "\n================================================\n\n";
+    async_use_mylog();
+
+    std::cout << "\n================================================\n\n";
+    ring_use_mylog();
+
+    std::cout << "\n================================================\n\n";
+    thread_name_use_mylog();
+
+    std::cout << "\n================================================\n\n";
+    binary_use_mylog();
+
+    std::cout << "\n================================================\n\n";
+    flush_use_mylog();
+
     return 0;
 }
\ No newline at end of file
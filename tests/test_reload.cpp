@@ -0,0 +1,80 @@
+#include <yaml-cpp/yaml.h>
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "log.h"
+
+// 多个线程持续输出日志的同时反复重新加载日志配置
+// reload_static在两份配置中相同，重新加载时保留原来的Appender
+static const char* s_configs[] = {
+    R"(
+logs:
+    - name: reload_static
+      level: info
+      appenders:
+          - type: AsyncLogAppender
+            file: reload_static.txt
+            flush_interval: 10
+    - name: reload
+      level: info
+      formatter: "%d%T%t%T%m%n"
+      appenders:
+          - type: FileLogAppender
+            file: reload_a.txt
+)",
+    R"(
+logs:
+    - name: reload_static
+      level: info
+      appenders:
+          - type: AsyncLogAppender
+            file: reload_static.txt
+            flush_interval: 10
+    - name: reload
+      level: debug
+      formatter: "%d%T[%p]%T%m%n"
+      appenders:
+          - type: FileLogAppender
+            file: reload_b.txt
+            formatter: "%t %m%n"
+          - type: AsyncLogAppender
+            file: reload_c.txt
+            flush_interval: 10
+)",
+};
+
+int main(int argc, char** argv) {
+    const int threads = 4;
+    const int reloads = 200;
+    mylog::Logger::ptr logger = MYLOG_LOG_NAME("reload");
+    mylog::Logger::ptr fixed  = MYLOG_LOG_NAME("reload_static");
+    mylog::Config::LoadFromYaml(YAML::Load(s_configs[0]));
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> count{0};
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back([&, i]() {
+            while (!stop) {
+                MYLOG_LOG_INFO(logger) << "reload thread " << i << " log " << count++;
+                MYLOG_LOG_INFO(fixed) << "static thread " << i;
+            }
+        });
+    }
+
+    for (int i = 0; i < reloads; ++i) {
+        mylog::Config::LoadFromYaml(YAML::Load(s_configs[i % 2]));
+        // 同时替换日志器的formatter
+        logger->setFormatter(i % 2 ? "%d%T%m%n" : "%t%T%m%n");
+    }
+    stop = true;
+    for (auto& i : workers) {
+        i.join();
+    }
+    std::cout << "reloads: " << reloads << " logs: " << count << "\n";
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include <iostream>
+
+#include "log_binary.h"
+
+// 将BinaryFileLogAppender输出的二进制日志还原为文本
+// 用法: mylog_decode <binary log file> [formatter pattern]
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "usage: " << argv[0] << " <binary log file> [formatter pattern]\n";
+        return 1;
+    }
+    std::ifstream ifs(argv[1], std::ios::in | std::ios::binary);
+    if (!ifs) {
+        std::cout << "open file " << argv[1] << " failed\n";
+        return 1;
+    }
+    // 默认使用与Logger相同的格式
+    mylog::LogFormatter::ptr formatter(
+        new mylog::LogFormatter(argc > 2 ? argv[2] : "%d%T%t %T%F%T[%p]%T[%c]%T%f:%l %T%m%n"));
+    if (formatter->isError()) {
+        std::cout << "invalid formatter pattern: " << formatter->getPattern() << "\n";
+        return 1;
+    }
+
+    mylog::BinaryLogDecoder decoder;
+    char buf[64 * 1024];
+    while (ifs) {
+        ifs.read(buf, sizeof(buf));
+        decoder.feed(buf, ifs.gcount());
+        while (mylog::LogEvent::ptr event = decoder.next()) {
+            std::cout << formatter->format(event->getLogger(), event->getLevel(), event);
+        }
+        if (decoder.isError()) {
+            std::cout << "invalid binary log data\n";
+            return 1;
+        }
+    }
+    if (decoder.hasPending()) {
+        std::cout << "binary log file is truncated\n";
+        return 1;
+    }
+    return 0;
+}